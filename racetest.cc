@@ -0,0 +1,172 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Test for WvDialRace: two modems race on Phone and Phone1 with an empty
+ * "Number Stats File", and each must dial a different number first.
+ *
+ * Usage: racetest
+ */
+
+#include "wvdialrace.h"
+#include "wvmodemsim.h"
+#include "wvlogfile.h"
+#include "uniconfroot.h"
+
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_MODEMS	2
+
+static const char *numbers[ NUM_MODEMS ] = { "5551111", "5552222" };
+
+static volatile bool timed_out = false;
+
+
+static void alarm_handler( int )
+/******************************/
+{
+    timed_out = true;
+}
+
+static pid_t run_modem( WvModemSim & sim, int report )
+/****************************************************/
+// Answer the dialer from a child process, and write the first number it
+// dials to 'report'.
+{
+    pid_t pid = fork();
+    if( pid != 0 )
+	return( pid );
+
+    bool reported = false;
+    for( ;; )
+    {
+	fd_set	rd;
+	int	fd = sim.getfd();
+	long	ms = sim.msec_until( wvdial_msecs() );
+
+	FD_ZERO( &rd );
+	if( fd >= 0 )
+	    FD_SET( fd, &rd );
+	struct timeval tv = { ms / 1000, ( ms % 1000 ) * 1000 };
+	select( fd + 1, &rd, NULL, NULL, ms < 0 ? NULL : &tv );
+	sim.poll( wvdial_msecs() );
+
+	if( !reported && sim.dialed()[0] )
+	{
+	    WvString line( "%s\n", sim.dialed() );
+	    if( write( report, line.cstr(), line.len() ) < 0 )
+		_exit( 1 );
+	    reported = true;
+	}
+    }
+}
+
+static WvString first_dialed( int report )
+/****************************************/
+{
+    char   buf[ 64 ];
+    size_t len = 0;
+    int    got;
+
+    while( len < sizeof( buf ) - 1
+	   && ( got = read( report, buf + len, sizeof( buf ) - 1 - len ) ) > 0 )
+	len += got;
+    buf[ len ] = '\0';
+
+    char *nl = strchr( buf, '\n' );
+    if( nl )
+	*nl = '\0';
+    return( buf );
+}
+
+
+int main()
+/********/
+{
+    char	dir[] = "/tmp/racetestXXXXXX";
+    WvModemSim	sims[ NUM_MODEMS ];
+    pid_t	pids[ NUM_MODEMS ];
+    int		reports[ NUM_MODEMS ];
+    int		result = 0;
+
+    if( !mkdtemp( dir ) )
+    {
+	perror( "mkdtemp" );
+	return( 1 );
+    }
+    WvString	statsfile( "%s/stats", dir );
+    WvString	devices( "" );
+
+    // a second for every CONNECT, so the loser has long since dialed too.
+    for( int i = 0; i < NUM_MODEMS; i++ )
+    {
+	int fds[2];
+	if( !sims[i].open() || pipe( fds ) < 0 )
+	{
+	    fprintf( stderr, "Cannot set up the modem simulators.\n" );
+	    return( 1 );
+	}
+	sims[i].set_delays( 0, 1000, 0 );
+	pids[i] = run_modem( sims[i], fds[1] );
+	::close( fds[1] );
+	reports[i] = fds[0];
+	devices.append( "%s%s", i ? " " : "", sims[i].slave() );
+    }
+
+    UniConfRoot	 uniconf( "temp:" );
+    WvConf	 cfg( uniconf );
+    WvStringList sections;
+    const char * d = "Dialer Defaults";
+
+    cfg.set( d, "Race Modems", devices );
+    cfg.set( d, "Phone", numbers[0] );
+    cfg.set( d, "Phone1", numbers[1] );
+    cfg.set( d, "Number Stats File", statsfile );
+    cfg.set( d, "Username", "race" );
+    cfg.set( d, "Password", "secret" );
+    cfg.set( d, "Carrier Check", "0" );
+    cfg.set( d, "Auto Reconnect", "0" );
+    cfg.set( d, "PPPD Path", "/bin/true" );
+    cfg.set( d, "Write Secrets", "0" );
+    sections.append( new WvString( d ), true );
+
+    signal( SIGALRM, alarm_handler );
+    alarm( 30 );
+
+    // the dialers' chatter goes here.
+    {
+	WvLogFile  quiet( "/dev/null", WvLog::Debug2 );
+	WvDialRace race( cfg, &sections );
+
+	if( race.isok() && race.dial() && !race.run( timed_out ) )
+	    fprintf( stderr, "Neither modem connected.\n" );
+    }
+    alarm( 0 );
+
+    for( int i = 0; i < NUM_MODEMS; i++ )
+    {
+	kill( pids[i], SIGTERM );
+	waitpid( pids[i], NULL, 0 );
+
+	WvString first = first_dialed( reports[i] );
+	::close( reports[i] );
+	if( first != numbers[i] )
+	{
+	    fprintf( stderr, "Modem %d dialed \"%s\" first, not %s.\n",
+		     i + 1, first.cstr(), numbers[i] );
+	    result = 1;
+	}
+    }
+
+    printf( "2 racers on 2 numbers with an empty stats file: %s\n",
+	    result ? "FAILED" : "ok" );
+    unlink( statsfile );
+    rmdir( dir );
+    return( result );
+}
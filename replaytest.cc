@@ -0,0 +1,188 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Test for wvdialreplay: captures a dial session through a login prompt
+ * to Online against a WvModemSim, then replays the capture and checks
+ * that the dialer gets online again, saying the same things.
+ *
+ * Usage: replaytest [path-to-wvdialreplay]
+ */
+
+#include "wvdialer.h"
+#include "wvmodemsim.h"
+#include "wvlogfile.h"
+#include "uniconfroot.h"
+
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char script[] =
+    "send \\r\\nlogin: \n"
+    "expect replay\n"
+    "send \\r\\nPassword: \n"
+    "expect secret\n"
+    "ppp\n";
+
+// Everything but the modem, which each side sets for itself.
+static const char *settings[][2] = {
+    { "Init1",		"ATZ" },
+    { "Phone",		"5551234" },
+    { "Username",	"replay" },
+    { "Password",	"secret" },
+    { "Carrier Check",	"0" },
+    { "Auto Reconnect",	"0" },
+    { "PPPD Path",	"/bin/true" },
+    { "Write Secrets",	"0" },
+    { NULL,		NULL }
+};
+
+
+static bool write_file( WvStringParm name, const char *text )
+/***********************************************************/
+{
+    FILE *f = fopen( name, "w" );
+    if( !f )
+	return( false );
+    fputs( text, f );
+    return( fclose( f ) == 0 );
+}
+
+static pid_t run_modem( WvModemSim & sim )
+/****************************************/
+// Answer the dialer from a child process, since the dialer waits for its
+// Init strings to be answered.
+{
+    pid_t pid = fork();
+    if( pid != 0 )
+	return( pid );
+
+    for( ;; )
+    {
+	fd_set	rd;
+	int	fd = sim.getfd();
+	long	ms = sim.msec_until( wvdial_msecs() );
+
+	FD_ZERO( &rd );
+	if( fd >= 0 )
+	    FD_SET( fd, &rd );
+	struct timeval tv = { ms / 1000, ( ms % 1000 ) * 1000 };
+	select( fd + 1, &rd, NULL, NULL, ms < 0 ? NULL : &tv );
+	sim.poll( wvdial_msecs() );
+    }
+}
+
+static bool capture_session( WvStringParm dir, WvStringParm capfile )
+/*******************************************************************/
+{
+    WvModemSim	sim;
+    WvString	scriptfile( "%s/script", dir );
+
+    if( !write_file( scriptfile, script ) || !sim.open()
+	|| !sim.load_script( scriptfile ) )
+    {
+	fprintf( stderr, "Cannot set up the modem simulator.\n" );
+	return( false );
+    }
+    pid_t modem_pid = run_modem( sim );
+
+    UniConfRoot	 uniconf( "temp:" );
+    WvConf	 cfg( uniconf );
+    WvStringList sections;
+    bool	 online = false;
+
+    for( int i = 0; settings[i][0]; i++ )
+	cfg.set( "Dialer Defaults", settings[i][0], settings[i][1] );
+    cfg.set( "Dialer Defaults", "Modem", sim.slave() );
+    cfg.set( "Dialer Defaults", "Capture File", capfile );
+    sections.append( new WvString( "Dialer Defaults" ), true );
+
+    {
+	WvDialer   dialer( cfg, &sections );
+	WvDialMsec give_up = wvdial_msecs() + 30000;
+
+	if( dialer.isok() && dialer.dial() )
+	{
+	    while( dialer.isok() && wvdial_msecs() < give_up )
+	    {
+		if( dialer.status() == WvDialer::Online )
+		{
+		    online = true;
+		    break;
+		}
+		if( dialer.select( 100 ) )
+		    dialer.callback();
+	    }
+	}
+	dialer.hangup();
+    }
+
+    kill( modem_pid, SIGTERM );
+    waitpid( modem_pid, NULL, 0 );
+
+    if( !online )
+	fprintf( stderr, "The captured session did not get online.\n" );
+    return( online );
+}
+
+
+int main( int argc, char * argv[] )
+/*********************************/
+{
+    const char * replay = argc > 1 ? argv[1] : "./wvdialreplay";
+    char	 dir[] = "/tmp/replaytestXXXXXX";
+
+    if( !mkdtemp( dir ) )
+    {
+	perror( "mkdtemp" );
+	return( 1 );
+    }
+    WvString	capfile( "%s/capture", dir );
+    WvString	conffile( "%s/wvdial.conf", dir );
+    int		result = 1;
+
+    // the dialers' chatter goes here; wvdialreplay's own report doesn't.
+    {
+	WvLogFile quiet( "/dev/null", WvLog::Debug2 );
+	if( !capture_session( dir, capfile ) )
+	    goto done;
+    }
+
+    {
+	WvString conf( "[Dialer Defaults]\n" );
+	for( int i = 0; settings[i][0]; i++ )
+	    conf.append( "%s = %s\n", settings[i][0], settings[i][1] );
+	if( !write_file( conffile, conf ) )
+	    goto done;
+    }
+
+    {
+	pid_t pid = fork();
+	if( pid == 0 )
+	{
+	    execl( replay, replay, "-o", capfile.cstr(), conffile.cstr(),
+		   (char *)NULL );
+	    perror( replay );
+	    _exit( 127 );
+	}
+
+	int st;
+	if( pid > 0 && waitpid( pid, &st, 0 ) == pid
+	    && WIFEXITED( st ) && WEXITSTATUS( st ) == 0 )
+	    result = 0;
+    }
+
+done:
+    printf( "replay of a CONNECT session to Online: %s\n",
+	    result ? "FAILED" : "ok" );
+    unlink( WvString( "%s/script", dir ) );
+    unlink( capfile );
+    unlink( conffile );
+    rmdir( dir );
+    return( result );
+}
@@ -9,6 +9,9 @@
 
 #include "wvargs.h"
 #include "wvdialer.h"
+#include "wvdialrace.h"
+#include "wvdialfleet.h"
+#include "wvdiallog.h"
 #include "version.h"
 #include "wvlog.h"
 #include "wvlogrcv.h"
@@ -25,15 +28,53 @@ volatile bool want_to_die = false;
 
 // use no prefix string for app "Modem", and an arrow for everything else.
 // This makes the output of the wvdial application look nicer.
-class WvDialLogger : public WvLogConsole
-/**************************************/
+class WvDialLogger : public WvLogConsole, public WvDialLogSink
+/************************************************************/
 {
 public:
-    WvDialLogger() : WvLogConsole(dup(2)) // log to stderr (fd 2)
+    WvDialLogger() : WvLogConsole(dup(2)), // log to stderr (fd 2)
+		     queue(*this)
         { }
 
+    // records wait here until the dialer is idle
+    WvDialLogQueue queue;
+
+    virtual void deliver(const char *source, int level, time_t when,
+			 const char *buf, size_t len)
+        { WvLogRcv::log(source, level, buf, len); }
+
 protected:
     virtual void _make_prefix(time_t now);
+    virtual void log(WvStringParm source, int level,
+		     const char *buf, size_t len)
+        { if (level <= max_level) queue.add(source, level, buf, len); }
+};
+
+
+// the same, for syslog in chat mode.
+class WvDialSyslog : public WvSyslog, public WvDialLogSink
+/********************************************************/
+{
+public:
+    WvDialSyslog(WvStringParm _prefix)
+	: WvSyslog(_prefix, false, WvLog::Debug2, WvLog::Debug2),
+	  queue(*this), logged_at(0)
+        { }
+
+    WvDialLogQueue queue;
+
+    virtual void deliver(const char *source, int level, time_t when,
+			 const char *buf, size_t len)
+        { logged_at = when; WvLogRcv::log(source, level, buf, len); }
+
+protected:
+    // the time the record was logged, rather than delivered
+    time_t logged_at;
+    virtual void _make_prefix(time_t now)
+        { WvSyslog::_make_prefix(logged_at); }
+    virtual void log(WvStringParm source, int level,
+		     const char *buf, size_t len)
+        { if (level <= max_level) queue.add(source, level, buf, len); }
 };
 
 
@@ -85,7 +126,7 @@ int main(int argc, char **argv)
 #endif
     
     WvDialLogger 	rc;
-    WvSyslog		*syslog = NULL;
+    WvDialSyslog	*syslog = NULL;
     WvLogFile           *filelog = NULL;
     UniConfRoot         uniconf("temp:");
     WvConf              cfg(uniconf);
@@ -96,10 +137,14 @@ int main(int argc, char **argv)
     
     bool chat_mode = false;
     bool write_syslog = true;
+    bool supervise = false;
     
     signal(SIGTERM, signalhandler);
     signal(SIGINT, signalhandler);
     signal(SIGHUP, signalhandler);
+    
+    // chat mode exit()s once the carrier is up; don't lose what was said.
+    atexit(WvDialLogQueue::flush_all);
 
     WvArgs args;
     args.set_version("WvDial " WVDIAL_VER_STRING "\n"
@@ -126,6 +171,9 @@ int main(int argc, char **argv)
 			     "used when running wvdial from pppd", chat_mode);
     args.add_reset_bool_option('n', "no-syslog",
 			       "don't send output to SYSLOG", chat_mode);
+    args.add_set_bool_option('S', "supervise",
+			     "run every [Dialer] section at once, "
+			     "restarting each as needed", supervise);
     args.add_optional_arg("SECTION", true);
     args.add_optional_arg("OPTION=value", true);
 
@@ -191,13 +239,25 @@ int main(int argc, char **argv)
 	return 1;
     }
     
+    // a line that won't stop talking mustn't drown out everything else.
+    int modem_log_rate = cfg.fuzzy_getint(sections, "Modem Log Rate",
+			    cfg.getint("Dialer Defaults", "Modem Log Rate", 100));
+    rc.queue.limit("WvDial Modem", modem_log_rate, modem_log_rate * 5);
+    
+    // for simulations: fixed delays and timeouts pass at once.
+    WvDialVirtualClock virtual_clock;
+    if (cfg.fuzzy_getint(sections, "Virtual Time",
+			 cfg.getint("Dialer Defaults", "Virtual Time", 0)))
+	wvdial_set_clock(&virtual_clock);
+    
     if (chat_mode) 
     { 
 	if (write_syslog) 
 	{ 
 	    WvString buf("wvdial[%s]", getpid()); 
-	    syslog = new WvSyslog( buf, false, WvLog::Debug2, 
-				   WvLog::Debug2 ); 
+	    syslog = new WvDialSyslog( buf ); 
+	    syslog->queue.limit("WvDial Modem", modem_log_rate, 
+				modem_log_rate * 5);
 	} 
 	else 
 	{ 
@@ -209,19 +269,37 @@ int main(int argc, char **argv)
 	} 
     }
     
-    WvDialer dialer(cfg, &sections, chat_mode);
+    if (supervise && !chat_mode)
+    {
+	WvDialFleet fleet(cfg, sections);
+	int retval = fleet.run(want_to_die);
+	
+	WVRELEASE(filelog);
+	delete syslog;
+	return retval;
+    }
+    
+    WvDialRace race(cfg, &sections, chat_mode);
     
     if (!chat_mode)
-	if (dialer.isok() && dialer.options.ask_password)
-	    dialer.ask_password();
+	if (race.isok() && race.first()->options.ask_password)
+	    race.ask_password();
     
-    if (dialer.dial() == false)
+    if (race.dial() == false)
 	return  1;
     
+    // with more than one "Race Modems", this runs until one connects.
+    WvDialer *winner = race.run(want_to_die);
+    if (!winner)
+	return 1;
+    WvDialer &dialer = *winner;
+    
     while (!want_to_die && dialer.isok() 
 	   && dialer.status() != WvDialer::Idle) 
     {
-	dialer.select(100);
+	// sleeps until the modem says something or the dialer's next
+	// deadline comes up.
+	dialer.select(-1);
 	dialer.callback();
     }
     
@@ -0,0 +1,670 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Little benchmark program for the pieces of WvDial that sit on the modem
+ * receive path.  Feeds synthetic line noise, with real modem responses
+ * mixed in, through them and reports throughput.  "flat" is the old
+ * flat-buffer/strstr() receive path and "oldnorm" the old four-pass
+ * input clean-up, for comparison.
+ *
+ * It also runs pppd "debug" output through WvDialMon::analyse_line(),
+ * either a built-in sample or a captured log named on the command line;
+ * "oldmon" is the old one-strstr()-per-message way of doing that.
+ *
+ * With -m, it runs a corpus of terminal server menus and prompts (see
+ * MENUS.corpus) through a WvDialer's brain instead, and reports how many
+ * come out with the expected answer, how fast, and how many times per
+ * sample operator new was called.  The dialer talks to a WvModemSim.
+ *
+ * Usage: wvdialbench [rounds [pppd-log]]
+ *        wvdialbench -m corpus [rounds]
+ */
+
+#include "wvdialer.h"
+#include "wvmodemsim.h"
+#include "wvdialrxbuf.h"
+#include "wvdialmatch.h"
+#include "wvdialnorm.h"
+#include "wvdialtimer.h"
+#include "wvdialmon.h"
+#include "wvlogfile.h"
+#include "strutils.h"
+#include "uniconfroot.h"
+
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <ctype.h>
+#include <new>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include <unistd.h>
+
+// Every operator new (and new[]) is counted, to see what allocates.
+static unsigned long	allocations;
+
+void *operator new( size_t size )
+/*******************************/
+{
+    allocations++;
+    void * p = malloc( size ? size : 1 );
+    if( !p )
+	throw std::bad_alloc();
+    return( p );
+}
+
+void operator delete( void * p ) throw()
+/**************************************/
+{
+    free( p );
+}
+
+static const char *	responses[] = {
+	"connect",
+	"no carrier",
+	"no dialtone",
+	"no dial tone",
+	"busy",
+	"error",
+	"voice",
+	"fclass",
+	"no answer",
+	NULL
+};
+#define NUM_RESPONSES	( sizeof( responses ) / sizeof( responses[0] ) - 1 )
+
+
+static size_t make_noise( char * buf, size_t size, int * planted )
+/****************************************************************/
+// Fill buf with lowercase line noise, planting a complete response line
+// every few hundred to couple of thousand bytes, each of responses[] in
+// turn.  Returns the number of bytes written.
+{
+    static const char noise[] = "abcdefghijklmnopqrstuvwxyz0123456789 ~}!{\r\n";
+    size_t len = 0;
+
+    *planted = 0;
+    while( len + 64 < size ) 
+    {
+	size_t run = 100 + rand() % 2000;	// sometimes overflows
+	for( ; run > 0 && len + 64 < size; run-- )
+	    buf[ len++ ] = noise[ rand() % ( sizeof( noise ) - 1 ) ];
+
+	len += sprintf( buf + len, "\r\n%s\r\n",
+			responses[ *planted % NUM_RESPONSES ] );
+	(*planted)++;
+    }
+    return( len );
+}
+
+
+static char	noise[ 1024 * 1024 + 1 ];
+static size_t	noise_len;
+static int	noise_planted;
+
+
+static void report( const char * what, int rounds, WvDialMsec elapsed,
+		    int found, unsigned long dropped )
+/********************************************************************/
+// found < 0 means the benchmark doesn't look for responses.
+{
+    if( elapsed <= 0 )
+	elapsed = 1;
+
+    printf( "%-8s %d x %lu bytes in %lld ms (%.1f MB/s)",
+	    what, rounds, (unsigned long)noise_len, elapsed,
+	    (double)noise_len * rounds / 1024 / 1024 * 1000 / elapsed );
+    if( found >= 0 )
+	printf( ", %d/%d responses found, %lu bytes dropped",
+		found, noise_planted * rounds, dropped );
+    printf( "\n" );
+}
+
+
+static void bench_rxbuf( int rounds )
+/***********************************/
+{
+    WvDialMatcher	matcher( responses );
+    WvDialRxBuf		rxbuf;
+    int			found = 0;
+
+    srand( 1 );
+    WvDialMsec start = wvdial_msecs();
+    for( int r = 0; r < rounds; r++ ) 
+    {
+	// feed it the way a serial port would: in small, uneven reads.
+	for( size_t off = 0; off < noise_len; ) 
+	{
+	    size_t n = 1 + rand() % 64;
+	    if( off + n > noise_len )
+		n = noise_len - off;
+	    rxbuf.append( noise + off, n );
+	    off += n;
+	    while( rxbuf.match( matcher, true ) >= 0 )
+		found++;
+	}
+    }
+    report( "rxbuf:", rounds, wvdial_msecs() - start, found, rxbuf.dropped() );
+}
+
+
+static void bench_flat( int rounds )
+/**********************************/
+{
+    char		buffer[ WvDialRxBuf::SIZE + 1 ];
+    size_t		offset = 0;
+    int			found = 0;
+    unsigned long	dropped = 0;
+
+    srand( 1 );
+    WvDialMsec start = wvdial_msecs();
+    for( int r = 0; r < rounds; r++ ) 
+    {
+	for( size_t off = 0; off < noise_len; ) 
+	{
+	    size_t n = 1 + rand() % 64;
+	    if( off + n > noise_len )
+		n = noise_len - off;
+	    if( n > WvDialRxBuf::SIZE - offset )
+		n = WvDialRxBuf::SIZE - offset;
+	    memcpy( buffer + offset, noise + off, n );
+	    offset += n;
+	    off += n;
+	    buffer[ offset ] = '\0';
+
+	    for( int i = 0; responses[i] != NULL; i++ ) 
+	    {
+		char * soff = strstr( buffer, responses[i] );
+		size_t len = strlen( responses[i] );
+		if( soff && ( strchr( soff, '\n' ) || strchr( soff, '\r' ) ) ) 
+		{
+		    memmove( buffer, soff + len, offset - ( soff+len - buffer ) );
+		    offset -= soff+len - buffer;
+		    buffer[ offset ] = '\0';
+		    found++;
+		    break;
+		}
+	    }
+
+	    if( offset == WvDialRxBuf::SIZE ) 
+	    {
+		memmove( buffer, buffer + WvDialRxBuf::SIZE/2,
+			 WvDialRxBuf::SIZE - WvDialRxBuf::SIZE/2 );
+		offset = WvDialRxBuf::SIZE/2;
+		dropped += WvDialRxBuf::SIZE/2;
+	    }
+	}
+    }
+    report( "flat:", rounds, wvdial_msecs() - start, found, dropped );
+}
+
+
+static void bench_normalise( int rounds )
+/***************************************/
+{
+    static char	raw[ sizeof( noise ) ];
+    static char	clean[ sizeof( noise ) ];
+    static char	lower[ sizeof( noise ) ];
+    WvDialMsec	start;
+
+    // real line noise has parity bits and NULs in it.
+    srand( 2 );
+    for( size_t i = 0; i < noise_len; i++ )
+	raw[i] = ( rand() % 50 ) ? noise[i] | ( rand() & 0x80 ) : '\0';
+
+    // the old way: what wait_for_modem() used to do to every chunk.
+    start = wvdial_msecs();
+    for( int r = 0; r < rounds; r++ ) 
+    {
+	memcpy( clean, raw, noise_len );
+	replace_char( clean, '\0', ' ', noise_len );
+	for( size_t i = 0; i < noise_len; i++ )
+	    clean[i] &= 0x7f;
+	replace_char( clean, '\0', ' ', noise_len );
+	memcpy( lower, clean, noise_len );
+	lower[ noise_len ] = '\0';
+	strlwr( lower );
+    }
+    report( "oldnorm:", rounds, wvdial_msecs() - start, -1, 0 );
+
+    start = wvdial_msecs();
+    for( int r = 0; r < rounds; r++ )
+	wvdial_normalise( raw, clean, lower, noise_len );
+    report( "norm:", rounds, wvdial_msecs() - start, -1, 0 );
+}
+
+
+// What "debug" in /etc/ppp/options makes pppd say during a typical call.
+// Mostly packet dumps, with LCP echoes making up the bulk of a long one.
+static const char *	pppd_sample[] = {
+	"using channel 17",
+	"Using interface ppp0",
+	"Connect: ppp0 <--> /dev/ttyS0",
+	"sent [LCP ConfReq id=0x1 <asyncmap 0x0> <magic 0x5e3c1a2b> <pcomp> <accomp>]",
+	"rcvd [LCP ConfReq id=0x1 <asyncmap 0xa0000> <auth pap> <magic 0x3b9f00e1> <pcomp> <accomp>]",
+	"sent [LCP ConfAck id=0x1 <asyncmap 0xa0000> <auth pap> <magic 0x3b9f00e1> <pcomp> <accomp>]",
+	"rcvd [LCP ConfAck id=0x1 <asyncmap 0x0> <magic 0x5e3c1a2b> <pcomp> <accomp>]",
+	"sent [PAP AuthReq id=0x1 user=\"joe\" password=<hidden>]",
+	"rcvd [PAP AuthAck id=0x1 \"Login ok\"]",
+	"sent [CCP ConfReq id=0x1 <deflate 15> <deflate(old#) 15> <bsd v1 15>]",
+	"sent [IPCP ConfReq id=0x1 <compress VJ 0f 01> <addr 0.0.0.0> <ms-dns1 0.0.0.0> <ms-dns3 0.0.0.0>]",
+	"rcvd [IPCP ConfNak id=0x1 <addr 10.1.2.3> <ms-dns1 10.0.0.1> <ms-dns3 10.0.0.2>]",
+	"rcvd [CCP ConfRej id=0x1 <deflate 15> <deflate(old#) 15> <bsd v1 15>]",
+	"local  IP address 10.1.2.3",
+	"remote IP address 10.0.0.254",
+	"primary   DNS address 10.0.0.1",
+	"secondary DNS address 10.0.0.2",
+	"Script /etc/ppp/ip-up started (pid 4242)",
+	"Script /etc/ppp/ip-up finished (pid 4242), status = 0x0",
+	"sent [LCP EchoReq id=0x0 magic=0x5e3c1a2b]",
+	"rcvd [LCP EchoRep id=0x0 magic=0x3b9f00e1]",
+	"sent [LCP EchoReq id=0x1 magic=0x5e3c1a2b]",
+	"rcvd [LCP EchoRep id=0x1 magic=0x3b9f00e1]",
+	"sent [LCP EchoReq id=0x2 magic=0x5e3c1a2b]",
+	"rcvd [LCP EchoRep id=0x2 magic=0x3b9f00e1]",
+	"rcvd [LCP TermReq id=0x2 \"User request\"]",
+	"sent [LCP TermAck id=0x2]",
+	"Connect time 12.3 minutes.",
+	"Sent 123456 bytes, received 654321 bytes.",
+	"Script /etc/ppp/ip-down started (pid 4250)",
+	"Terminating on signal 15.",
+	NULL
+};
+
+#define MAX_PPPD_LINES	65536
+
+static char	pppd_text[ 1024 * 1024 ];
+static char *	pppd_lines[ MAX_PPPD_LINES ];
+static int	num_pppd_lines;
+static size_t	pppd_bytes;
+
+
+static void load_pppd_log( const char * filename )
+/************************************************/
+// Fill pppd_lines[] from the captured log, or from pppd_sample[] repeated
+// up to about a megabyte.
+{
+    FILE *	f = filename ? fopen( filename, "r" ) : NULL;
+    size_t	used = 0;
+
+    if( filename && !f )
+	fprintf( stderr, "Cannot read %s; using the built-in sample.\n",
+		 filename );
+
+    num_pppd_lines = 0;
+    for( int i = 0; num_pppd_lines < MAX_PPPD_LINES; i++ )
+    {
+	char * line = pppd_text + used;
+	size_t room = sizeof( pppd_text ) - used;
+
+	if( room < 256 )
+	    break;
+	if( f )
+	{
+	    if( !fgets( line, room, f ) )
+		break;
+	    line[ strcspn( line, "\r\n" ) ] = '\0';
+	}
+	else
+	{
+	    const char * s = pppd_sample[ i % ( sizeof( pppd_sample ) 
+						/ sizeof( *pppd_sample ) - 1 ) ];
+	    strcpy( line, s );
+	}
+
+	pppd_lines[ num_pppd_lines++ ] = line;
+	used += strlen( line ) + 1;
+    }
+    pppd_bytes = used;
+
+    if( f )
+	fclose( f );
+}
+
+
+static void report_pppd( const char * what, int rounds, WvDialMsec elapsed )
+/**************************************************************************/
+{
+    if( elapsed <= 0 )
+	elapsed = 1;
+
+    printf( "%-8s %d x %d lines (%lu bytes) in %lld ms "
+	    "(%.1f MB/s, %.0f lines/s)\n",
+	    what, rounds, num_pppd_lines, (unsigned long)pppd_bytes, elapsed,
+	    (double)pppd_bytes * rounds / 1024 / 1024 * 1000 / elapsed,
+	    (double)num_pppd_lines * rounds * 1000 / elapsed );
+}
+
+
+static int old_analyse_line( const char * line, regex_t * rx_quote,
+			     regex_t * rx_status )
+/*****************************************************************/
+// The matching analyse_line() used to do, without the logging: one search
+// per kind of message, and a regex for quoted text and script status.
+{
+    static const char * anywhere[] = {
+	"AuthReq", "AuthAck", "AuthNak", "CHAP Challenge", "CHAP Success",
+	"CHAP Failure", "LCP TermReq", NULL
+    };
+    static const char * prefix[] = {
+	"local  IP address", "remote IP address", "primary   DNS address",
+	"secondary DNS address", "Script", "Connect time", "Using interface",
+	"Terminating", NULL
+    };
+    regmatch_t	rm[1];
+    int		hits = 0;
+
+    for( int i = 0; anywhere[i]; i++ )
+    {
+	if( strstr( line, anywhere[i] ) != NULL )
+	{
+	    char buf[ strlen( line ) ];
+	    if( regexec( rx_quote, line, 1, rm, 0 ) == 0 )
+		memcpy( buf, line + rm[0].rm_so, rm[0].rm_eo - rm[0].rm_so );
+	    hits++;
+	}
+    }
+    for( int i = 0; prefix[i]; i++ )
+	if( !strncmp( line, prefix[i], strlen( prefix[i] ) ) )
+	    hits++;
+    if( !strncmp( line, "Script", 6 ) && strstr( line, "/etc/ppp/ip-up" )
+	&& strstr( line, "finished" ) 
+	&& regexec( rx_status, line, 1, rm, 0 ) == 0 )
+	hits++;
+    return( hits );
+}
+
+
+static void bench_pppmon( int rounds )
+/************************************/
+{
+    regex_t	rx_quote, rx_status;
+    WvDialMsec	start;
+    volatile int hits = 0;	// so the old matching is not optimised away
+
+    regcomp( &rx_status, "status *= *", REG_EXTENDED );
+    regcomp( &rx_quote, "\\\"[^\\\"]+\\\"", REG_EXTENDED );
+
+    start = wvdial_msecs();
+    for( int r = 0; r < rounds; r++ )
+	for( int i = 0; i < num_pppd_lines; i++ )
+	    hits += old_analyse_line( pppd_lines[i], &rx_quote, &rx_status );
+    report_pppd( "oldmon:", rounds, wvdial_msecs() - start );
+
+    regfree( &rx_quote );
+    regfree( &rx_status );
+
+    // WvDialMon logs what it finds; keep that off the terminal.
+    WvLogFile	quiet( "/dev/null", WvLog::Debug2 );
+    WvDialMon	mon;
+
+    start = wvdial_msecs();
+    for( int r = 0; r < rounds; r++ )
+	for( int i = 0; i < num_pppd_lines; i++ )
+	    mon.analyse_line( pppd_lines[i] );
+    report_pppd( "mon:", rounds, wvdial_msecs() - start );
+}
+
+
+struct BrainSample
+{
+    bool	prompt;		// check_prompt(), or just guess_menu()
+    char	expect[ 32 ];	// "" for no answer
+    char *	text;		// lowercase, like the dialer's receive buffer
+    int		line;
+};
+
+#define MAX_SAMPLES	4096
+
+static char		corpus_text[ 1024 * 1024 ];
+static BrainSample	samples[ MAX_SAMPLES ];
+static int		num_samples;
+static size_t		longest_sample;
+
+
+static bool load_corpus( const char * filename )
+/**********************************************/
+{
+    FILE *	  f = fopen( filename, "r" );
+    char	  line[ 1024 ];
+    char	  what[ 16 ];
+    size_t	  used = 0;
+    int		  lineno = 0;
+    BrainSample * s = NULL;
+
+    if( !f )
+    {
+	perror( filename );
+	return( false );
+    }
+
+    num_samples = 0;
+    while( fgets( line, sizeof( line ), f ) )
+    {
+	lineno++;
+	line[ strcspn( line, "\r\n" ) ] = '\0';
+
+	if( !s )
+	{
+	    // between samples: comments, blank lines, or the next header.
+	    if( !line[0] || line[0] == '#' )
+		continue;
+	    if( num_samples == MAX_SAMPLES )
+		break;
+	    s = &samples[ num_samples ];
+	    if( sscanf( line, "%15s %31s", what, s->expect ) != 2
+		|| ( strcmp( what, "menu" ) && strcmp( what, "prompt" ) ) )
+	    {
+		fprintf( stderr, "%s:%d: expected \"menu\" or \"prompt\", "
+			 "and an answer\n", filename, lineno );
+		fclose( f );
+		return( false );
+	    }
+	    s->prompt = !strcmp( what, "prompt" );
+	    if( !strcmp( s->expect, "-" ) )
+		s->expect[0] = '\0';
+	    s->text = corpus_text + used;
+	    s->text[0] = '\0';
+	    s->line = lineno;
+	    continue;
+	}
+
+	if( !strcmp( line, "%%" ) )
+	{
+	    size_t len = strlen( s->text );
+	    used += len + 1;
+	    if( len > longest_sample )
+		longest_sample = len;
+	    num_samples++;
+	    s = NULL;
+	    continue;
+	}
+
+	size_t len = strlen( line );
+	if( used + strlen( s->text ) + len + 3 > sizeof( corpus_text ) )
+	    break;
+	if( s->text[0] )
+	    strcat( s->text, "\r\n" );
+	for( char * p = line; *p; p++ )
+	    *p = tolower( *p );
+	strcat( s->text, line );
+    }
+    fclose( f );
+
+    if( s )
+	fprintf( stderr, "%s: the last sample has no \"%%%%\"\n", filename );
+    return( num_samples > 0 );
+}
+
+
+static const char * try_sample( WvDialBrain & brain, const BrainSample & s,
+				char * buf )
+/************************************************************************/
+// What the brain answers to the sample, or NULL, the way
+// wait_for_modem() and async_waitprompt() would ask it.
+{
+    strcpy( buf, s.text );
+    brain.reset();
+
+    const char * after = brain.guess_menu( buf );
+    if( !s.prompt )
+	return( brain.menu_response()[0] ? brain.menu_response() : NULL );
+
+    // the dialer drops everything up to the last "ppp" guess_menu() found.
+    return( brain.check_prompt( after ? after : buf ) );
+}
+
+
+class FrozenClock : public WvDialClock
+/************************************/
+// Time stands still while the brain is being tried out, so prompts never
+// time out and is_pending() never waits.
+{
+public:
+    FrozenClock()
+	: t( WvDialClock::now() ) {}
+
+    virtual WvDialMsec	now()
+        { return( t ); }
+    virtual time_t	real_wait( time_t )
+        { return( 0 ); }
+
+private:
+    WvDialMsec	t;
+};
+
+
+static pid_t run_modem( WvModemSim & sim )
+/****************************************/
+// Answer the dialer's init strings from a child process, since the
+// dialer waits for them.
+{
+    pid_t pid = fork();
+    if( pid != 0 )
+	return( pid );
+
+    for( ;; )
+    {
+	fd_set	rd;
+	int	fd = sim.getfd();
+	long	ms = sim.msec_until( wvdial_msecs() );
+
+	FD_ZERO( &rd );
+	if( fd >= 0 )
+	    FD_SET( fd, &rd );
+	struct timeval tv = { ms / 1000, ( ms % 1000 ) * 1000 };
+	select( fd + 1, &rd, NULL, NULL, ms < 0 ? NULL : &tv );
+	sim.poll( wvdial_msecs() );
+    }
+}
+
+
+static int bench_brain( const char * corpus, int rounds )
+/*******************************************************/
+{
+    if( !load_corpus( corpus ) )
+	return( 1 );
+
+    WvModemSim	sim;
+    if( !sim.open() )
+    {
+	perror( "pty" );
+	return( 1 );
+    }
+    pid_t	modem_pid = run_modem( sim );
+
+    // the brain logs what it guesses; keep that off the terminal.
+    WvLogFile	 quiet( "/dev/null", WvLog::Debug2 );
+    UniConfRoot	 uniconf( "temp:" );
+    WvConf	 cfg( uniconf );
+    WvStringList sections;
+
+    cfg.set( "Dialer Defaults", "Modem", sim.slave() );
+    cfg.set( "Dialer Defaults", "Username", "wvbench" );
+    cfg.set( "Dialer Defaults", "Password", "benchpw" );
+    cfg.set( "Dialer Defaults", "Default Reply", "ppp" );
+    cfg.set( "Dialer Defaults", "Carrier Check", "0" );
+    cfg.set( "Dialer Defaults", "Write Secrets", "0" );
+    sections.append( new WvString( "Dialer Defaults" ), true );
+
+    WvDialer	dialer( cfg, &sections );
+    int		wrong = 0;
+
+    if( !dialer.isok() )
+    {
+	fprintf( stderr, "The dialer did not start on %s.\n", sim.slave() );
+	wrong = num_samples;
+	goto done;
+    }
+
+    {
+	FrozenClock   frozen;
+	WvDialClock   real;
+	WvDialBrain & brain = dialer.prompt_brain();
+	char *	      buf = new char[ longest_sample + 1 ];
+
+	wvdial_set_clock( &frozen );
+
+	for( int i = 0; i < num_samples; i++ )
+	{
+	    const char * got = try_sample( brain, samples[i], buf );
+	    if( strcmp( got ? got : "", samples[i].expect ) )
+	    {
+		printf( "%s:%d: %s: expected \"%s\", got \"%s\"\n", corpus,
+			samples[i].line, samples[i].prompt ? "prompt" : "menu",
+			samples[i].expect[0] ? samples[i].expect : "-",
+			got ? got : "-" );
+		wrong++;
+	    }
+	}
+
+	unsigned long	allocs = allocations;
+	WvDialMsec	start  = real.now();
+	for( int r = 0; r < rounds; r++ )
+	    for( int i = 0; i < num_samples; i++ )
+		try_sample( brain, samples[i], buf );
+	WvDialMsec	elapsed = real.now() - start;
+	long		tries	= (long)rounds * num_samples;
+
+	if( elapsed <= 0 )
+	    elapsed = 1;
+	printf( "brain:   %d x %d samples in %lld ms (%.0f samples/s, "
+		"%.1f allocations/sample), %d/%d right\n",
+		rounds, num_samples, elapsed, (double)tries * 1000 / elapsed,
+		(double)( allocations - allocs ) / tries,
+		num_samples - wrong, num_samples );
+
+	wvdial_set_clock( NULL );
+	delete[] buf;
+    }
+
+done:
+    kill( modem_pid, SIGTERM );
+    waitpid( modem_pid, NULL, 0 );
+    return( wrong ? 1 : 0 );
+}
+
+
+int main( int argc, char * argv[] )
+/*********************************/
+{
+    if( argc > 2 && !strcmp( argv[1], "-m" ) )
+	return( bench_brain( argv[2], argc > 3 ? atoi( argv[3] ) : 1000 ) );
+
+    int rounds = argc > 1 ? atoi( argv[1] ) : 20;
+
+    srand( 42 );
+    noise_len = make_noise( noise, sizeof( noise ), &noise_planted );
+
+    bench_flat( rounds );
+    bench_rxbuf( rounds );
+    bench_normalise( rounds );
+
+    load_pppd_log( argc > 2 ? argv[2] : NULL );
+    bench_pppmon( rounds );
+
+    return( 0 );
+}
@@ -56,7 +56,7 @@ const char * WvDialBrain::guess_menu( char * buf )
     char *	 cptr = NULL; 
     char *	 line; 
     char *	 nextline;
-    BrainToken * tok;
+    int		 count;
 
     while( strstr( buf, "ppp" ) != NULL ) {
     	cptr = strstr( buf, "ppp" );
@@ -73,11 +73,9 @@ const char * WvDialBrain::guess_menu( char * buf )
 	buf = nextline; // now 'continue' will check the next line
 
 	// Now tokenize the line and perform an IntelliSearch (tm)
-	tok = tokenize( line, nextline );
-	if( tok ) {
-	    guess_menu_guts( tok );	// may call set_prompt_response()
-	    token_list_done( tok );
-	}
+	count = tokenize( line, nextline );
+	if( count )
+	    guess_menu_guts( token_buf, count ); // may call set_prompt_response()
     }
     if( cptr )
 	return( cptr + 4 );	// return pointer directly AFTER "ppp".
@@ -88,11 +86,10 @@ const char * WvDialBrain::guess_menu( char * buf )
 const char * WvDialBrain::check_prompt( const char * buffer )
 /***********************************************************/
 {
-    WvString tprompt;
-    
     // If we've been here too many times, or too long ago, just give up and
     // start pppd.
-    if( prompt_tries >= 5 || time( NULL ) - dialer->last_rx >= 10 ) {
+    if( prompt_tries >= 5 
+	|| wvdial_msecs() - dialer->last_rx >= dialer->options.prompt_timeout_ms ) {
     	dialer->log( WvLog::Notice, "Don't know what to do!  "
     		"Starting pppd and hoping for the best.\n" );
     	dialer->start_ppp();
@@ -130,7 +127,8 @@ const char * WvDialBrain::check_prompt( const char * buffer )
     		     "Sending: %s\n", login );
     	dialer->reset_offset();
     	prompt_tries++;
-	return( login );
+	reply = login;
+	return( reply );
 
     } else if( is_password_prompt( buffer ) ) {
         const char *passwd = 0;
@@ -168,11 +166,12 @@ const char * WvDialBrain::check_prompt( const char * buffer )
     	prompt_tries++;
 
 	// only use our prompt guess the first time.
-	// if it fails, go back to the default reply.
-	tprompt = prompt_response;
+	// if it fails, go back to the default reply.  The caller gets a
+	// pointer, so the guess has to live on in 'reply'.
+	reply = prompt_response;
 	prompt_response = "";
 	
-    	return( tprompt );
+    	return( reply );
 
     } else {
     	// not a prompt at all!
@@ -317,19 +316,36 @@ bool WvDialBrain::is_welcome_msg( const char * buf )
     			    strstr( buf, "ip address is" ) ) );
 }
 
-BrainToken * WvDialBrain::tokenize( char * left, char * right )
+static bool tok_is( const BrainToken & tok, const char * word )
 /*************************************************************/
 {
-    BrainToken *   token_list = NULL;
-    BrainToken *   new_token  = NULL;
-    BrainToken *   prev_token = NULL;
-    char * 	   p;
+    return( !strncmp( tok.str, word, tok.len ) && word[ tok.len ] == '\0' );
+}
+
+static bool is_bad_word( const BrainToken & tok )
+/***********************************************/
+// Whether the word appears anywhere in menu_bad_words, as strstr() would
+// find it.
+{
+    for( const char * p = menu_bad_words; ( p = strchr( p, tok.str[0] ) ); p++ )
+	if( !strncmp( p, tok.str, tok.len ) )
+	    return( true );
+    return( false );
+}
+
+int WvDialBrain::tokenize( const char * left, const char * right )
+/****************************************************************/
+// Split the line from left up to right into token_buf[], which point into
+// the line rather than copying it.  Returns the number of tokens.
+{
+    const char * p;
+    int		 count = 0;
 
     if( left == NULL || right == NULL || right <= left )
-    	return( NULL );
+    	return( 0 );
 
     p = left;
-    while( p <= right ) {
+    while( p <= right && count < MAX_TOKENS ) {
 	// If *p is a null or a new-line, we are done.
 	if( *p == '\0' || isnewline( *p ) )
 	    break;
@@ -340,84 +356,44 @@ BrainToken * WvDialBrain::tokenize( char * left, char * right )
 	    continue;
 	}
 
+	BrainToken & tok = token_buf[ count ];
+	const char * end = p+1;
+	tok.str = p;
+
 	// If it's a letter, we've got the beginning of a word.
 	if( isalpha( *p ) ) {
-	    char * end = p+1;
-	    new_token = new BrainToken;
-	    new_token->type = TOK_WORD;
-	    new_token->next = NULL;
-	    if( token_list == NULL )
-	    	token_list = new_token;
-	    else
-	    	prev_token->next = new_token;
+	    tok.type = TOK_WORD;
 	    while( end <= right && isalpha( *end ) )
 	    	end++;
-	    new_token->tok_str = new char[ end - p + 1 ];
-	    strncpy( new_token->tok_str, p, end - p );
-	    new_token->tok_str[ end-p ] = '\0';
-	    p = end;	// skip to the end of the word for next time
-	    prev_token = new_token;
-	    continue;
 	}
 
 	// If it's a digit, we've got the beginning of a number.
-	if( isdigit( *p ) ) {
-	    char * end = p+1;
-	    new_token = new BrainToken;
-	    new_token->type = TOK_NUMBER;
-	    new_token->next = NULL;
-	    if( token_list == NULL )
-	    	token_list = new_token;
-	    else
-	    	prev_token->next = new_token;
+	else if( isdigit( *p ) ) {
+	    tok.type = TOK_NUMBER;
 	    while( end <= right && isdigit( *end ) )
 	    	end++;
-	    new_token->tok_str = new char[ end - p + 1 ];
-	    strncpy( new_token->tok_str, p, end - p );
-	    new_token->tok_str[ end-p ] = '\0';
-	    p = end;	// skip to the end of the number for next time
-	    prev_token = new_token;
-	    continue;
 	}
 
 	// If it's useful punctuation (brackets and such), grab it.
-	if( strchr( brackets, *p ) ) {
-	    new_token = new BrainToken;
-	    new_token->type = TOK_PUNCT;
-	    new_token->next = NULL;
-	    if( token_list == NULL )
-	    	token_list = new_token;
-	    else
-	    	prev_token->next = new_token;
-	    new_token->tok_char = *p;
+	else if( strchr( brackets, *p ) )
+	    tok.type = TOK_PUNCT;
+
+	// If it's anything else, ignore it.
+	else {
 	    p++;
-	    prev_token = new_token;
 	    continue;
-	 }
+	}
 
-	 // If it's anything else, ignore it.
-	 p++;
+	tok.len = end - p;
+	p = end;	// skip to the end of the token for next time
+	count++;
     }
 
-    return( token_list );
-}
-
-void WvDialBrain::token_list_done( BrainToken * token_list )
-/**********************************************************/
-{
-    BrainToken * next_token;
-
-    while( token_list != NULL ) {
-    	next_token = token_list->next;
-    	if( token_list->type == TOK_WORD || token_list->type == TOK_NUMBER )
-    	    delete token_list->tok_str;
-    	delete token_list;
-    	token_list = next_token;
-    }
+    return( count );
 }
 
-void WvDialBrain::guess_menu_guts( BrainToken * token_list )
-/**********************************************************/
+void WvDialBrain::guess_menu_guts( const BrainToken * tokens, int count )
+/***********************************************************************/
 // There are some cases which may occur in a valid menu line.
 // Number 1 is of the form "P for PPP"
 // Number 2 is of the form "1 - start PPP"
@@ -431,11 +407,11 @@ void WvDialBrain::guess_menu_guts( BrainToken * token_list )
 // At least it doesn't randomly return from the middle of the function before
 // trying all the cases...
 {
-    BrainToken *	lmarker = NULL;
-    BrainToken *	rmarker = NULL;
-    BrainToken *	tok;
-    char *		prompt_resp = NULL;
-    int			index;
+    int		lmarker = -1;
+    int		rmarker = -1;
+    int		tok;
+    int		prompt_resp = -1;
+    int		index;
 
     /////////////// FIRST CASE
     // This should be generalized later, but for now we'll look for "FOR PPP",
@@ -443,18 +419,18 @@ void WvDialBrain::guess_menu_guts( BrainToken * token_list )
     // we'll use it as a prompt response.  If it IS punctuation, but is NOT
     // a bracket, we'll take the thing before THAT even, and use it as a prompt
     // response.
-    for( tok = token_list; tok != NULL; tok = tok->next ) {
+    for( tok = 0; tok < count; tok++ ) {
         bool failed = false;
-    	if( tok->type == TOK_PUNCT )
+    	if( tokens[tok].type == TOK_PUNCT )
     	    continue;
 
     	// Only looking at words and numbers now.
-    	BrainToken * tok2 = tok->next;
-    	for( ; tok2 != NULL; tok2 = tok2->next ) {
-    	    if( tok2->type != TOK_PUNCT )
+    	int tok2 = tok + 1;
+    	for( ; tok2 < count; tok2++ ) {
+    	    if( tokens[tok2].type != TOK_PUNCT )
     	    	break;
     	    // Only looking at punctuation after the word we're investigating.
-    	    if( strchr( brackets, tok2->tok_char ) ) {
+    	    if( strchr( brackets, tokens[tok2].str[0] ) ) {
     	    	failed = true;
     	    	break;
     	    }
@@ -462,16 +438,15 @@ void WvDialBrain::guess_menu_guts( BrainToken * token_list )
     	if( failed )
     	    continue;
 
-    	if( !tok2 || !tok2->next )
+    	if( tok2 + 1 >= count )
     	    break;
 
     	// Now tok is the potential response, and tok2 is the next word or
     	// number, as long as there were no brackets in between.
     	// So now we can look for "for ppp".
-    	if( !strcmp( tok2->tok_str, "for" ) &&
-    	    !strcmp( tok2->next->tok_str, "ppp" ) )
+    	if( tok_is( tokens[tok2], "for" ) && tok_is( tokens[tok2+1], "ppp" ) )
     	{
-    	    set_prompt_response( tok->tok_str );
+    	    set_prompt_response( tokens[tok] );
     	    return;
     	}
     }
@@ -480,40 +455,40 @@ void WvDialBrain::guess_menu_guts( BrainToken * token_list )
     // Find the first right-bracket on the line, and evaluate everything
     // before it.  Things that are allowed are numbers, and words other 
     // than "press" etc.
-    for( tok = token_list; tok != NULL; tok = tok->next )
-    	if( tok->type == TOK_PUNCT )
-    	    if( strchr( rbrackets, tok->tok_char ) ) {
+    for( tok = 0; tok < count; tok++ )
+    	if( tokens[tok].type == TOK_PUNCT )
+    	    if( strchr( rbrackets, tokens[tok].str[0] ) ) {
     	    	rmarker = tok;	// leftmost right-bracket on this line.
     	    	break;
     	    }
-    if( rmarker == NULL )
+    if( rmarker < 0 )
 	goto three;		// no right-bracket on this line.
 
     // Make sure "ppp" comes _AFTER_ the rmarker...  So that we don't respond
     // to "I like food (ppp is fun too)" or similar things.
-    for( tok = rmarker->next; tok != NULL; tok = tok->next )
-    	if( tok->type == TOK_WORD && strcmp( tok->tok_str, "ppp" ) == 0 )
+    for( tok = rmarker + 1; tok < count; tok++ )
+    	if( tokens[tok].type == TOK_WORD && tok_is( tokens[tok], "ppp" ) )
     	    break;
-    if( tok == NULL )	// We did not find "ppp" after the rmarker
+    if( tok == count )	// We did not find "ppp" after the rmarker
     	goto three;
 
-    for( tok = token_list; tok != rmarker; tok = tok->next ) {
+    for( tok = 0; tok < rmarker; tok++ ) {
     	// If we find punctuation in here, then Case Two is WRONG.
     	// Also, handles things like "Press 5" or "Type ppp" correctly.
     	// If there's more than one valid "thing", use the last one.
-    	if( tok->type == TOK_PUNCT ) {
-    	    prompt_resp = NULL;
+    	if( tokens[tok].type == TOK_PUNCT ) {
+    	    prompt_resp = -1;
     	    break;
     	}
-    	if( tok->type == TOK_NUMBER )
-    	    prompt_resp = tok->tok_str;
-    	if( tok->type == TOK_WORD )
-    	    if( strstr( menu_bad_words, tok->tok_str ) == NULL )
-    	    	prompt_resp = tok->tok_str;
+    	if( tokens[tok].type == TOK_NUMBER )
+    	    prompt_resp = tok;
+    	if( tokens[tok].type == TOK_WORD )
+    	    if( !is_bad_word( tokens[tok] ) )
+    	    	prompt_resp = tok;
     }
 
-    if( prompt_resp != NULL ) {		// Case Two was successful!
-    	set_prompt_response( prompt_resp );
+    if( prompt_resp >= 0 ) {		// Case Two was successful!
+    	set_prompt_response( tokens[prompt_resp] );
     	return;
     }
 
@@ -529,11 +504,11 @@ three:
     //
     // Nov 6/98: Ummmmm, does the above paragraph make sense?
     bool ready_to_break = false;
-    rmarker 		= NULL;
-    for( tok = token_list; tok != NULL; tok = tok->next ) {
+    rmarker 		= -1;
+    for( tok = 0; tok < count; tok++ ) {
 
-    	if( tok->type == TOK_PUNCT ) {
-    	    if( strchr( lbrackets, tok->tok_char ) ) {
+    	if( tokens[tok].type == TOK_PUNCT ) {
+    	    if( strchr( lbrackets, tokens[tok].str[0] ) ) {
     	    	lmarker = tok;
     	    	ready_to_break = true;
     	    }
@@ -542,38 +517,38 @@ three:
     	    	break;
     	}
     }
-    if( lmarker == NULL )
+    if( lmarker < 0 )
 	goto four;		// no left-bracket on this line.
 
     // Now find the matching bit of punctuation in the remainder.
     // Watch for useful words as we do it...
-    index = strchr( lbrackets, lmarker->tok_char ) - lbrackets;
-    for( tok = lmarker->next; tok != NULL; tok = tok->next ) {
-    	if( tok->type == TOK_PUNCT ) {
-    	    if( tok->tok_char == rbrackets[ index ] ) {
+    index = strchr( lbrackets, tokens[lmarker].str[0] ) - lbrackets;
+    for( tok = lmarker + 1; tok < count; tok++ ) {
+    	if( tokens[tok].type == TOK_PUNCT ) {
+    	    if( tokens[tok].str[0] == rbrackets[ index ] ) {
     	    	rmarker = tok;
     	    	break;
     	    }
-    	} else if( tok->type == TOK_WORD ) {
-    	    if( strstr( menu_bad_words, tok->tok_str ) == NULL )
-    	    	prompt_resp = tok->tok_str;
-    	} else // tok->type == TOK_NUMBER
-    	    prompt_resp = tok->tok_str;
+    	} else if( tokens[tok].type == TOK_WORD ) {
+    	    if( !is_bad_word( tokens[tok] ) )
+    	    	prompt_resp = tok;
+    	} else // tokens[tok].type == TOK_NUMBER
+    	    prompt_resp = tok;
     }
 
-    if( rmarker == NULL )
+    if( rmarker < 0 )
     	goto four;		// no corresponding right-bracket on this line.
 
     // Make sure "ppp" comes _AFTER_ the rmarker...  So that we don't respond
     // to "I like food (ppp is fun too)" or similar things.
-    for( tok = rmarker->next; tok != NULL; tok = tok->next )
-    	if( tok->type == TOK_WORD && strcmp( tok->tok_str, "ppp" ) == 0 )
+    for( tok = rmarker + 1; tok < count; tok++ )
+    	if( tokens[tok].type == TOK_WORD && tok_is( tokens[tok], "ppp" ) )
     	    break;
-    if( tok == NULL )	// We did not find "ppp" after the rmarker
+    if( tok == count )	// We did not find "ppp" after the rmarker
 	goto four;
     
-    if( prompt_resp != NULL ) {		// Case Three was successful
-	set_prompt_response( prompt_resp );
+    if( prompt_resp >= 0 ) {		// Case Three was successful
+	set_prompt_response( tokens[prompt_resp] );
     	return;
     }
     
@@ -584,17 +559,15 @@ four:
     //       2   Quit
     // Let's just assume the command is a single-digit number.  This should
     // avoid accidentally parsing phone numbers or IP addresses.
-    lmarker = token_list;
-    if ( lmarker->type == TOK_NUMBER
-	 && lmarker->tok_str[0] && !lmarker->tok_str[1] )
+    if ( tokens[0].type == TOK_NUMBER && tokens[0].len == 1 )
     {
-	for ( tok = token_list; tok != NULL; tok = tok->next )
-	    if (tok->type == TOK_WORD && strcmp( tok->tok_str, "ppp" ) == 0 )
+	for ( tok = 0; tok < count; tok++ )
+	    if (tokens[tok].type == TOK_WORD && tok_is( tokens[tok], "ppp" ) )
 		break;
 	
-	if ( tok )
+	if ( tok < count )
 	{
-	    set_prompt_response( lmarker->tok_str ); // Case Four worked!
+	    set_prompt_response( tokens[0] ); // Case Four worked!
 	    return;
 	}
     }
@@ -604,18 +577,17 @@ four:
     return;
 }
 
-void WvDialBrain::set_prompt_response( char * str )
-/*************************************************/
+void WvDialBrain::set_prompt_response( const BrainToken & tok )
+/*************************************************************/
 {
     WvString	n;
 
-    if( strcmp( str, prompt_response ) ) {
-	n.setsize( strlen( str ) + 1 );
-	strcpy( n.edit(), str );
-	n.edit()[ strlen( str ) ] = '\0';
+    if( !tok_is( tok, prompt_response.cstr() ) ) {
+	n.setsize( tok.len + 1 );
+	memcpy( n.edit(), tok.str, tok.len );
+	n.edit()[ tok.len ] = '\0';
 
     	dialer->log( "Found a good menu option: \"%s\".\n", n );
     	prompt_response = n;
     }
 }
-
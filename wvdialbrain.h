@@ -28,11 +28,12 @@ enum BrainTokenType
 
 struct BrainToken
 /***************/
+// A word, number or bracket, pointing into the text it came from; str is
+// not nul-terminated.
 {
     BrainTokenType	type;
-    char *		tok_str;
-    char		tok_char;
-    BrainToken *	next;
+    int			len;
+    const char *	str;
 };
 
 class WvDialBrain
@@ -48,12 +49,17 @@ public:
     const char *	guess_menu( char * buf );
     int                 saw_first_compuserve_prompt;
 
+    // The answer guess_menu() has found for the next prompt, or "".
+    const char *	menu_response() const
+        { return( prompt_response ); }
+
 private:
     WvDialer *		dialer;
     
     int			sent_login;
     int			prompt_tries;
     WvString		prompt_response;
+    WvString		reply;		// what check_prompt() last returned
 
     // These functions are called from check_prompt()....
     bool 		is_prompt( const char * c, 
@@ -64,23 +70,15 @@ private:
     bool		is_password_prompt( const char * buf );
     bool		is_welcome_msg( const char * buf );
 
-    // Menu-string tokenizer....
-    BrainToken *	tokenize( char * left, char * right );
-    BrainToken * tokenize( char * str );
-    void		token_list_done( BrainToken * token_list );
+    // Menu-string tokenizer....  Enough tokens for a line filling the
+    // whole receive buffer, so none is ever cut short.
+    enum { MAX_TOKENS = 1024 };
+    BrainToken		token_buf[ MAX_TOKENS ];
+    int			tokenize( const char * left, const char * right );
 
     // Called from guess_menu....
-    void		guess_menu_guts( BrainToken * token_list );
-    void		set_prompt_response( char * str );
+    void		guess_menu_guts( const BrainToken * tokens, int count );
+    void		set_prompt_response( const BrainToken & tok );
 };
 
-inline BrainToken * WvDialBrain::tokenize( char * str )
-/*****************************************************/
-{
-    if( str == NULL ) 
-    	return( NULL );
-
-    return( tokenize( str, str+strlen( str ) - 1 ) );
-}
-
 #endif // __WVDIALBRAIN_H
@@ -0,0 +1,164 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Capture files.  See wvdialcapture.h.
+ *
+ */
+
+#include "wvdialcapture.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+const char * const WvDialCapture::type_names[ NUM_TYPES ] = {
+    "rx", "tx", "pppd"
+};
+
+static const char magic[4] = { 'W', 'v', 'D', 'c' };
+
+
+static void put_le( unsigned char *p, unsigned long long v, int bytes )
+/*********************************************************************/
+{
+    for( int i = 0; i < bytes; i++, v >>= 8 )
+	p[i] = v & 0xff;
+}
+
+static unsigned long long get_le( const unsigned char *p, int bytes )
+/*******************************************************************/
+{
+    unsigned long long v = 0;
+    for( int i = bytes - 1; i >= 0; i-- )
+	v = ( v << 8 ) | p[i];
+    return( v );
+}
+
+
+WvDialCapture::WvDialCapture()
+/****************************/
+: f( NULL ), writing( false ), start_time( 0 ), start( 0 )
+{
+}
+
+WvDialCapture::~WvDialCapture()
+/*****************************/
+{
+    close();
+}
+
+bool WvDialCapture::create( WvStringParm filename )
+/*************************************************/
+{
+    unsigned char hdr[ 16 ];
+
+    close();
+
+    // the Password goes by in the clear, so only we may read it.
+    int fd = ::open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+    if( fd < 0 )
+	return( false );
+    fchmod( fd, 0600 );		// in case it was already there
+    f = fdopen( fd, "w" );
+    if( !f )
+    {
+	::close( fd );
+	return( false );
+    }
+
+    writing    = true;
+    start      = wvdial_msecs();
+    start_time = time( NULL );
+
+    memset( hdr, 0, sizeof( hdr ) );
+    memcpy( hdr, magic, 4 );
+    hdr[4] = VERSION;
+    put_le( hdr + 8, start_time, 8 );
+    fwrite( hdr, sizeof( hdr ), 1, f );
+    return( true );
+}
+
+bool WvDialCapture::open( WvStringParm filename )
+/***********************************************/
+{
+    unsigned char hdr[ 16 ];
+
+    close();
+    f = fopen( filename, "r" );
+    if( !f )
+	return( false );
+
+    writing = false;
+    if( fread( hdr, sizeof( hdr ), 1, f ) != 1 
+	|| memcmp( hdr, magic, 4 ) || hdr[4] != VERSION )
+    {
+	close();
+	return( false );
+    }
+    start_time = get_le( hdr + 8, 8 );
+    return( true );
+}
+
+void WvDialCapture::close()
+/*************************/
+{
+    if( f )
+	fclose( f );
+    f = NULL;
+}
+
+void WvDialCapture::flush()
+/*************************/
+{
+    if( f && writing )
+	fflush( f );
+}
+
+void WvDialCapture::record( Type type, const char *buf, size_t len )
+/******************************************************************/
+{
+    if( !f || !writing )
+	return;
+
+    unsigned long ms = wvdial_msecs() - start;
+    do
+    {
+	unsigned char hdr[ 7 ];
+	size_t part = len < MAX_DATA ? len : MAX_DATA;
+
+	put_le( hdr, ms, 4 );
+	hdr[4] = type;
+	put_le( hdr + 5, part, 2 );
+	fwrite( hdr, sizeof( hdr ), 1, f );
+	fwrite( buf, part, 1, f );
+	buf += part;
+	len -= part;
+    } while( len > 0 );
+}
+
+bool WvDialCapture::next( Record &r, char *buf, size_t size )
+/***********************************************************/
+{
+    unsigned char hdr[ 7 ];
+
+    if( !f || writing || fread( hdr, sizeof( hdr ), 1, f ) != 1 )
+	return( false );
+
+    r.ms   = get_le( hdr, 4 );
+    r.type = (Type)hdr[4];
+    r.len  = get_le( hdr + 5, 2 );
+    if( r.type >= NUM_TYPES )
+	return( false );
+
+    // keep what fits, skip the rest.
+    size_t keep = r.len < size ? r.len : size;
+    if( keep && fread( buf, keep, 1, f ) != 1 )
+	return( false );
+    if( keep < r.len && fseek( f, r.len - keep, SEEK_CUR ) < 0 )
+	return( false );
+    r.len = keep;
+    return( true );
+}
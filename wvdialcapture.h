@@ -0,0 +1,73 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Capture files: everything said to and by the modem, and everything pppd
+ * logged, with timestamps, so a dial session can be replayed later.
+ *
+ */
+
+#ifndef __WVDIALCAPTURE_H
+#define __WVDIALCAPTURE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "wvstring.h"
+#include "wvdialtimer.h"
+
+class WvDialCapture
+/*****************/
+// The file starts with the magic "WvDc", a version byte and three bytes
+// of padding, then the wall-clock time the capture started as 8 bytes.
+// Each record after that is
+//
+//	4 bytes	milliseconds since the capture started
+//	1 byte	type (Rx, Tx, Pppd)
+//	2 bytes	length
+//	length bytes of data
+//
+// with all numbers little-endian.  The same object writes captures or
+// reads them back, depending on how it was opened.
+{
+public:
+    enum Type { Rx, Tx, Pppd, NUM_TYPES };
+    enum { VERSION = 1, MAX_DATA = 65535 };
+    static const char * const type_names[ NUM_TYPES ];
+
+    struct Record
+    {
+	unsigned long	ms;
+	Type		type;
+	size_t		len;
+    };
+
+    WvDialCapture();
+    ~WvDialCapture();
+
+    bool	create( WvStringParm filename );
+    bool	open( WvStringParm filename );
+    void	close();
+    bool	isok() const
+        { return( f != NULL ); }
+
+    // Wall-clock time the capture was started.
+    time_t	started() const
+        { return( start_time ); }
+
+    // Writing; longer data is split into several records.
+    void	record( Type type, const char *buf, size_t len );
+    void	flush();
+
+    // Reading: fills in r and up to size bytes of buf.  Returns false at
+    // the end of the file, or if it is damaged.
+    bool	next( Record &r, char *buf, size_t size );
+
+private:
+    FILE *	f;
+    bool	writing;
+    time_t	start_time;
+    WvDialMsec	start;
+};
+
+#endif // __WVDIALCAPTURE_H
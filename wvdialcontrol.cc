@@ -0,0 +1,281 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * The dialer's control socket.  See wvdialcontrol.h.
+ *
+ */
+
+#include "wvdialcontrol.h"
+#include "wvdialer.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+static const char *state_names[] = {
+    "idle", "modem_error", "other_error", "online", "dial", "predial1",
+    "predial2", "wait_dial", "wait_anything", "wait_prompt",
+    "auto_reconnect_delay", "init"
+};
+
+
+WvDialControl::WvDialControl( WvDialer &_dialer )
+/***********************************************/
+: dialer( _dialer ), path_dev( 0 ), path_ino( 0 ), fd( -1 ), 
+  pending( None )
+{
+    for( int i = 0; i < MAX_CLIENTS; i++ )
+	clients[i].fd = -1;
+}
+
+WvDialControl::~WvDialControl()
+/*****************************/
+{
+    close();
+}
+
+bool WvDialControl::listen( WvStringParm _path )
+/**********************************************/
+{
+    struct sockaddr_un addr;
+
+    close();
+    if( _path.len() >= sizeof( addr.sun_path ) )
+    {
+	errno = ENAMETOOLONG;
+	return( false );
+    }
+
+    fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( fd < 0 )
+	return( false );
+    fcntl( fd, F_SETFD, FD_CLOEXEC );
+    fcntl( fd, F_SETFL, O_NONBLOCK );
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, _path );
+
+    // only we should be able to hang up the line.
+    unlink( _path );
+    mode_t oldmask = umask( 077 );
+    int	   res     = bind( fd, (struct sockaddr *)&addr, sizeof( addr ) );
+    umask( oldmask );
+
+    if( res < 0 || ::listen( fd, MAX_CLIENTS ) < 0 )
+    {
+	int e = errno;
+	close();
+	errno = e;
+	return( false );
+    }
+
+    struct stat st;
+    if( stat( _path, &st ) == 0 )
+    {
+	path_dev = st.st_dev;
+	path_ino = st.st_ino;
+    }
+    path = _path;
+    return( true );
+}
+
+void WvDialControl::close()
+/*************************/
+{
+    for( int i = 0; i < MAX_CLIENTS; i++ )
+	drop_client( clients[i] );
+
+    // someone else may have taken the path over since.
+    struct stat st;
+    if( fd >= 0 && !!path && stat( path, &st ) == 0
+	&& st.st_dev == path_dev && st.st_ino == path_ino )
+	unlink( path );
+    if( fd >= 0 )
+	::close( fd );
+    fd	    = -1;
+    path    = "";
+    pending = None;
+}
+
+void WvDialControl::pre_select( fd_set &rd, int &max_fd ) const
+/*************************************************************/
+{
+    if( fd < 0 )
+	return;
+
+    FD_SET( fd, &rd );
+    if( fd > max_fd )
+	max_fd = fd;
+
+    for( int i = 0; i < MAX_CLIENTS; i++ )
+    {
+	if( clients[i].fd < 0 )
+	    continue;
+	FD_SET( clients[i].fd, &rd );
+	if( clients[i].fd > max_fd )
+	    max_fd = clients[i].fd;
+    }
+}
+
+bool WvDialControl::post_select( const fd_set &rd )
+/*************************************************/
+{
+    if( fd < 0 )
+	return( false );
+
+    for( int i = 0; i < MAX_CLIENTS; i++ )
+    {
+	if( clients[i].fd >= 0 && FD_ISSET( clients[i].fd, &rd ) 
+	    && !read_client( clients[i] ) )
+	    drop_client( clients[i] );
+    }
+
+    if( FD_ISSET( fd, &rd ) )
+	accept_client();
+
+    return( pending != None );
+}
+
+WvDialControl::Command WvDialControl::take_command()
+/**************************************************/
+{
+    Command c = pending;
+    pending = None;
+    return( c );
+}
+
+void WvDialControl::accept_client()
+/*********************************/
+{
+    int cfd;
+
+    while( ( cfd = accept( fd, NULL, NULL ) ) >= 0 )
+    {
+	int i;
+	for( i = 0; i < MAX_CLIENTS && clients[i].fd >= 0; i++ )
+	    ;
+	if( i == MAX_CLIENTS )
+	{
+	    ::close( cfd );	// busy; try again later
+	    continue;
+	}
+	fcntl( cfd, F_SETFD, FD_CLOEXEC );
+	fcntl( cfd, F_SETFL, O_NONBLOCK );
+	clients[i].fd  = cfd;
+	clients[i].len = 0;
+    }
+}
+
+void WvDialControl::drop_client( Client &c )
+/******************************************/
+{
+    if( c.fd >= 0 )
+	::close( c.fd );
+    c.fd  = -1;
+    c.len = 0;
+}
+
+bool WvDialControl::read_client( Client &c )
+/******************************************/
+// Answers every complete line that has arrived.  Returns false once the
+// client should be dropped.
+{
+    ssize_t len = read( c.fd, c.buf + c.len, sizeof( c.buf ) - c.len );
+    if( len < 0 )
+	return( errno == EAGAIN || errno == EINTR );
+    if( len == 0 )
+	return( false );
+    c.len += len;
+
+    char *start = c.buf, *end = c.buf + c.len, *nl;
+    while( ( nl = (char *)memchr( start, '\n', end - start ) ) != NULL )
+    {
+	*nl = '\0';
+	if( nl > start && nl[-1] == '\r' )
+	    nl[-1] = '\0';
+
+	WvString reply( "%s\n", answer( start ) );
+	// replies are short; a client that can't take one is not reading.
+	if( send( c.fd, reply.cstr(), reply.len(), MSG_NOSIGNAL ) 
+	        != (ssize_t)reply.len() )
+	    return( false );
+	start = nl + 1;
+    }
+
+    c.len = end - start;
+    if( c.len == sizeof( c.buf ) )
+	return( false );	// no command is that long
+    memmove( c.buf, start, c.len );
+    return( true );
+}
+
+WvString WvDialControl::answer( const char *line )
+/************************************************/
+{
+    while( *line == ' ' )
+	line++;
+
+    if( !strcmp( line, "status" ) )
+	return( status() );
+    if( !strcmp( line, "timeline" ) )
+	return( dialer.timeline().json() );
+    if( !strcmp( line, "phases" ) )
+	return( dialer.phase_stats().json() );
+    if( !strcmp( line, "link" ) )
+	return( dialer.link_stats().json() );
+    if( !strcmp( line, "events" ) )
+	return( events() );
+
+    if( !strcmp( line, "hangup" ) )
+	pending = Hangup;
+    else if( !strcmp( line, "redial" ) )
+	pending = Redial;
+    else if( !strcmp( line, "next" ) )
+	pending = NextNumber;
+    else
+	return( "{\"error\":\"unknown command\"}" );
+
+    return( WvString( "{\"ok\":\"%s\"}", line ) );
+}
+
+WvString WvDialControl::events()
+/******************************/
+// Takes every event waiting in the dialer's WvDialMon, which is the ring's
+// only consumer.
+{
+    WvDialMon & mon = dialer.pppd_mon;
+    WvDialEvent ev;
+    WvString	s( "{\"dropped\":%s,\"events\":[", mon.events_dropped() );
+
+    for( bool first = true; mon.get_event( ev ); first = false )
+	s.append( "%s%s", first ? "" : ",", ev.json() );
+    s.append( "]}" );
+    return( s );
+}
+
+WvString WvDialControl::status() const
+/************************************/
+{
+    WvDialer::Status st = dialer.status();
+    const char *	 cs = dialer.connect_status();
+
+    WvString s( "{\"state\":\"%s\",\"connect_attempts\":%s,\"dial_stat\":%s",
+		state_names[ st ], dialer.connect_attempts, dialer.dial_stat );
+    if( cs )
+	s.append( ",\"connect_status\":\"%s\"", cs );
+    if( !!dialer.dialing && !strpbrk( dialer.dialing, "\"\\" ) )
+	s.append( ",\"number\":\"%s\"", dialer.dialing );
+    if( st == WvDialer::AutoReconnectDelay )
+	s.append( ",\"reconnect_in\":%s", dialer.auto_reconnect_time() );
+    if( st == WvDialer::Online )
+	s.append( ",\"online_ms\":%s", wvdial_msecs() - dialer.connected_at );
+    s.append( "}" );
+    return( s );
+}
@@ -0,0 +1,84 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A Unix domain socket for asking a running dialer how it is doing, and
+ * telling it what to do.
+ *
+ */
+
+#ifndef __WVDIALCONTROL_H
+#define __WVDIALCONTROL_H
+
+#include <sys/select.h>
+#include <sys/types.h>
+
+#include "wvstring.h"
+
+class WvDialer;
+
+class WvDialControl
+/*****************/
+// The protocol is one command per line, answered by one line of JSON:
+//
+//   status     state, connect_status(), attempts, dial_stat, the number
+//              being dialed and the auto-reconnect countdown
+//   timeline   the current (or last) dial session
+//   phases     the phase timing statistics of all sessions
+//   link       the link sampler's counters and rates
+//   events     the pppd events not yet taken, and how many were lost
+//   hangup     hang up
+//   redial     redial now, abandoning any attempt in progress
+//   next       move on to the next phone number
+//
+// Queries are answered straight from post_select(), without waking the
+// dialer up.  Commands are answered at once too, but only acted upon when
+// the dialer next runs; see take_command().
+{
+public:
+    enum Command { None, Hangup, Redial, NextNumber };
+    enum { MAX_CLIENTS = 8, LINE_SIZE = 128 };
+
+    WvDialControl( WvDialer &_dialer );
+    ~WvDialControl();
+
+    // Listens on the socket at 'path', replacing anything already there.
+    bool	listen( WvStringParm _path );
+    void	close();
+    bool	isok() const
+        { return( fd >= 0 ); }
+
+    void	pre_select( fd_set &rd, int &max_fd ) const;
+
+    // Accepts, reads and answers whatever is ready.  Returns true if a
+    // command is now waiting.
+    bool	post_select( const fd_set &rd );
+
+    // The last command received, if it hasn't been taken yet.
+    Command	take_command();
+
+private:
+    struct Client
+    {
+	int	fd;
+	size_t	len;
+	char	buf[ LINE_SIZE ];
+    };
+
+    WvDialer &	dialer;
+    WvString	path;
+    dev_t	path_dev;	// what we bound at 'path', so close() only
+    ino_t	path_ino;	// removes our own socket
+    int		fd;
+    Client	clients[ MAX_CLIENTS ];
+    Command	pending;
+
+    void	accept_client();
+    bool	read_client( Client &c );
+    void	drop_client( Client &c );
+    WvString	answer( const char *line );
+    WvString	status() const;
+    WvString	events();
+};
+
+#endif // __WVDIALCONTROL_H
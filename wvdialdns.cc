@@ -0,0 +1,311 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A non-blocking check that DNS works.  See wvdialdns.h.
+ *
+ */
+
+#include "wvdialdns.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+
+#define DNS_PORT	53
+#define RESOLV_CONF	"/etc/resolv.conf"
+#define URANDOM		"/dev/urandom"
+
+
+static unsigned short random_id()
+/*******************************/
+// Query IDs are all that keeps a stray or spoofed reply from passing for
+// ours, so they must not be the same every run.
+{
+    unsigned short id;
+
+    int rfd = open( URANDOM, O_RDONLY );
+    if( rfd >= 0 )
+    {
+	bool got = ( read( rfd, &id, sizeof( id ) ) == sizeof( id ) );
+	close( rfd );
+	if( got )
+	    return( id );
+    }
+
+    // no /dev/urandom: the clock and our pid are better than nothing.
+    static unsigned short last;
+    last = (unsigned short)( last * 31 + time( NULL ) * 1009 
+			     + getpid() * 17 + wvdial_msecs() );
+    return( last );
+}
+
+
+WvDialDNSCheck::WvDialDNSCheck()
+/******************************/
+: fd( -1 ), deadline( 0 ), next_send( 0 ), passed( false )
+{
+    memset( &server, 0, sizeof( server ) );
+}
+
+WvDialDNSCheck::~WvDialDNSCheck()
+/*******************************/
+{
+    cancel();
+}
+
+bool WvDialDNSCheck::find_server( WvStringParm spec )
+/***************************************************/
+{
+    char addr[ 64 ];
+    int  port = DNS_PORT;
+
+    addr[0] = '\0';
+    if( !!spec )
+    {
+	if( sscanf( spec, "%63[^:]:%d", addr, &port ) < 1 )
+	    addr[0] = '\0';
+    }
+    else
+    {
+	FILE *fin = fopen( RESOLV_CONF, "r" );
+	if( fin == NULL )
+	{
+	    why = WvString( "can't read `%s'", RESOLV_CONF );
+	    return( false );
+	}
+
+	char line[ 256 ];
+	while( fgets( line, sizeof( line ), fin ) != NULL )
+	{
+	    struct in_addr a;
+	    if( sscanf( line, " nameserver %63s", addr ) == 1 
+		&& inet_aton( addr, &a ) )
+		break;
+	    addr[0] = '\0';
+	}
+	fclose( fin );
+    }
+
+    server.sin_family = AF_INET;
+    server.sin_port   = htons( port );
+    if( !addr[0] || !inet_aton( addr, &server.sin_addr ) )
+    {
+	why = !!spec ? WvString( "bad DNS server `%s'", spec )
+		     : WvString( "no nameserver found in `%s'", RESOLV_CONF );
+	return( false );
+    }
+    return( true );
+}
+
+bool WvDialDNSCheck::start( WvStringParm spec, WvStringParm name1, 
+			    WvStringParm name2, int timeout_ms )
+/*****************************************************************/
+{
+    cancel();
+    passed = false;
+    why    = "";
+
+    if( !find_server( spec ) )
+	return( false );
+
+    fd = socket( AF_INET, SOCK_DGRAM, 0 );
+    if( fd < 0 || connect( fd, (struct sockaddr *)&server, 
+			   sizeof( server ) ) < 0 )
+    {
+	why = WvString( "can't reach the nameserver: %s", strerror( errno ) );
+	cancel();
+	return( false );
+    }
+    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
+    queries[0].name = name1;
+    queries[1].name = name2;
+    for( int i = 0; i < NUM_NAMES; i++ )
+    {
+	queries[i].id    = random_id();
+	queries[i].state = !queries[i].name ? 1 : 0;
+	make_question( queries[i] );
+    }
+
+    deadline = wvdial_msecs() + timeout_ms;
+    send_all();
+    return( true );
+}
+
+void WvDialDNSCheck::cancel()
+/***************************/
+{
+    if( fd >= 0 )
+	::close( fd );
+    fd = -1;
+}
+
+long WvDialDNSCheck::msec_until( WvDialMsec now ) const
+/*****************************************************/
+{
+    if( fd < 0 )
+	return( -1 );
+
+    WvDialMsec when = next_send < deadline ? next_send : deadline;
+    return( when > now ? (long)( when - now ) : 0 );
+}
+
+void WvDialDNSCheck::make_question( Query &q )
+/********************************************/
+// The name as length-prefixed labels, type A, class IN.
+{
+    unsigned char *p   = q.question;
+    size_t	   len = 0;
+
+    const char *name = q.name;
+    while( name && *name && len < MAX_QUESTION - 70 )
+    {
+	size_t label = strcspn( name, "." );
+	if( label > 63 )
+	    label = 63;
+	p[ len++ ] = label;
+	memcpy( p + len, name, label );
+	len  += label;
+	name += label;
+	if( *name == '.' )
+	    name++;
+    }
+    p[ len++ ] = 0;
+    p[ len++ ] = 0; p[ len++ ] = 1;	// QTYPE A
+    p[ len++ ] = 0; p[ len++ ] = 1;	// QCLASS IN
+    q.qlen = len;
+}
+
+void WvDialDNSCheck::send_all()
+/*****************************/
+// One standard query per name still waiting: a 12-byte header asking for
+// recursion, then the question.
+{
+    for( int i = 0; i < NUM_NAMES; i++ )
+    {
+	Query &q = queries[i];
+	if( q.state != 0 )
+	    continue;
+
+	unsigned char	pkt[ 12 + MAX_QUESTION ];
+	size_t		len = 0;
+
+	pkt[ len++ ] = q.id >> 8;
+	pkt[ len++ ] = q.id & 0xff;
+	pkt[ len++ ] = 0x01;		// RD
+	pkt[ len++ ] = 0x00;
+	pkt[ len++ ] = 0; pkt[ len++ ] = 1;	// QDCOUNT
+	memset( pkt + len, 0, 6 );		// AN/NS/ARCOUNT
+	len += 6;
+
+	memcpy( pkt + len, q.question, q.qlen );
+	len += q.qlen;
+
+	::send( fd, pkt, len, 0 );
+    }
+    next_send = wvdial_msecs() + RESEND_MS;
+}
+
+bool WvDialDNSCheck::answers( const Query &q, const unsigned char *pkt,
+			      size_t len ) const
+/*******************************************************************/
+// A reply to q has q's ID and asks q's one question again.  Names are
+// compared without case, as some servers mix it up.
+{
+    if( len < 12 + q.qlen || q.id != ( ( pkt[0] << 8 ) | pkt[1] ) 
+	|| !( pkt[2] & 0x80 ) || ( ( pkt[4] << 8 ) | pkt[5] ) != 1 )
+	return( false );
+
+    const unsigned char *p = pkt + 12;
+    size_t		 i = 0;
+    while( i < q.qlen - 4 )
+    {
+	size_t label = q.question[i];
+	if( p[i] != label 
+	    || strncasecmp( (const char *)p + i + 1, 
+			    (const char *)q.question + i + 1, label ) )
+	    return( false );
+	i += label + 1;
+    }
+    return( !memcmp( p + i, q.question + i, 4 ) );
+}
+
+void WvDialDNSCheck::receive()
+/****************************/
+// A reply counts as "found" if it has no error and at least one answer,
+// which is what gethostbyname() needed too.
+{
+    unsigned char pkt[ 512 ];
+    ssize_t	  len;
+
+    while( ( len = recv( fd, pkt, sizeof( pkt ), 0 ) ) >= 12 )
+    {
+	int rcode   = pkt[3] & 0x0f;
+	int records = ( pkt[6] << 8 ) | pkt[7];
+
+	for( int i = 0; i < NUM_NAMES; i++ )
+	{
+	    Query &q = queries[i];
+	    if( q.state != 0 || !answers( q, pkt, len ) )
+		continue;
+	    q.state = ( rcode == 0 && records > 0 ) ? 1 : -1;
+	}
+    }
+}
+
+bool WvDialDNSCheck::poll()
+/*************************/
+{
+    if( fd < 0 )
+	return( false );
+
+    receive();
+
+    for( int i = 0; i < NUM_NAMES; i++ )
+    {
+	if( queries[i].state < 0 )
+	{
+	    finish( false, WvString( "can't find address for `%s'",
+				     queries[i].name ) );
+	    return( true );
+	}
+    }
+
+    bool waiting = false;
+    for( int i = 0; i < NUM_NAMES; i++ )
+	if( queries[i].state == 0 )
+	    waiting = true;
+
+    if( !waiting )
+    {
+	finish( true, "" );
+	return( true );
+    }
+
+    WvDialMsec now = wvdial_msecs();
+    if( now >= deadline )
+    {
+	finish( false, "no answer from the nameserver" );
+	return( true );
+    }
+    if( now >= next_send )
+	send_all();
+    return( false );
+}
+
+void WvDialDNSCheck::finish( bool _passed, WvStringParm _why )
+/************************************************************/
+{
+    passed = _passed;
+    why    = _why;
+    cancel();
+}
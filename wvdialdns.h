@@ -0,0 +1,81 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A non-blocking check that DNS works, for right after the link comes up.
+ *
+ */
+
+#ifndef __WVDIALDNS_H
+#define __WVDIALDNS_H
+
+#include <netinet/in.h>
+
+#include "wvstring.h"
+#include "wvdialtimer.h"
+
+class WvDialDNSCheck
+/******************/
+// Sends an A query for each test name, all at once, straight to the
+// nameserver over UDP, and resends unanswered ones every second until the
+// deadline.  The caller puts getfd() in its select() and calls poll() when
+// it is readable or msec_until() runs out.
+{
+public:
+    WvDialDNSCheck();
+    ~WvDialDNSCheck();
+
+    // 'server' is "a.b.c.d" or "a.b.c.d:port"; if empty, the first
+    // nameserver in /etc/resolv.conf is used.  Returns false, with
+    // result() set, if the check could not even be started.
+    bool	start( WvStringParm server, WvStringParm name1, 
+		       WvStringParm name2, int timeout_ms );
+    void	cancel();
+
+    bool	running() const
+        { return( fd >= 0 ); }
+    int		getfd() const
+        { return( fd ); }
+
+    // msec until poll() must be called even without a reply, or -1.
+    long	msec_until( WvDialMsec now ) const;
+
+    // Reads replies, resends or gives up as needed.  Returns true when the
+    // check has just finished; then ok() and result() say how it went.
+    bool	poll();
+
+    bool	ok() const
+        { return( passed ); }
+    WvString	result() const
+        { return( why ); }
+
+private:
+    enum { NUM_NAMES = 2, RESEND_MS = 1000, MAX_QUESTION = 260 };
+
+    struct Query
+    {
+	WvString	name;
+	unsigned short	id;
+	int		state;		// 0 waiting, 1 found, -1 not found
+	unsigned char	question[ MAX_QUESTION ];  // QNAME, QTYPE, QCLASS
+	size_t		qlen;
+    };
+
+    Query		queries[ NUM_NAMES ];
+    int			fd;
+    struct sockaddr_in	server;
+    WvDialMsec		deadline;
+    WvDialMsec		next_send;
+    bool		passed;
+    WvString		why;
+
+    bool	find_server( WvStringParm spec );
+    void	make_question( Query &q );
+    bool	answers( const Query &q, const unsigned char *pkt, 
+			 size_t len ) const;
+    void	send_all();
+    void	receive();
+    void	finish( bool _passed, WvStringParm _why );
+};
+
+#endif // __WVDIALDNS_H
@@ -7,6 +7,8 @@
  */
 
 #include "wvdialer.h"
+#include "wvdialmatch.h"
+#include "wvdialnorm.h"
 #include "version.h"
 
 #include <sys/types.h>
@@ -49,32 +51,49 @@ static const char *	prompt_strings[] = {
 	NULL
 };
 
+// The tables above, compiled once.
+static WvDialMatcher	init_matcher( init_responses );
+static WvDialMatcher	dial_matcher( dial_responses );
+static WvDialMatcher	prompt_matcher( prompt_strings );
+
 static int messagetail_pid = 0;
 
 //**************************************************
 //       WvDialer Public Functions
 //**************************************************
 
-WvDialer::WvDialer( WvConf &_cfg, WvStringList *_sect_list, bool _chat_mode )
+WvDialer::WvDialer( WvConf &_cfg, WvStringList *_sect_list, bool _chat_mode,
+		    bool _async_init )
 /***************************************************************************/
 : WvStreamClone( 0 ),
     cfg(_cfg), log( "WvDial", WvLog::Debug ),
     err( log.split( WvLog::Error ) ),
-    modemrx( "WvDial Modem", WvLog::Debug )
+    modemrx( "WvDial Modem", WvLog::Debug ),
+    control( *this )
 {
     ppp_pipe 		 = NULL;
     pppd_log		 = NULL;
     been_online 	 = false;
     stat 		 = Idle;
-    offset 		 = 0;
     prompt_tries 	 = 0;
-    last_rx 		 = last_execute = 0;
+    rxline_len		 = 0;
+    last_rx 		 = 0;
     prompt_response 	 = "";
     auto_reconnect_delay = 0;
     auto_reconnect_at    = 0;
     connected_at         = 0;
     phnum_count = 0;
     phnum_max = 0;      
+    for( int i = 0; i < 5; i++ )
+	phnum_order[i] = i;
+    race_offset = 0;
+    dial_sent_at = 0;
+    async_init    = _async_init && !_chat_mode;
+    init_step     = InitOpen;
+    init_try      = 0;
+    init_num      = 0;
+    init_resent   = false;
+    init_deadline = 0;
     // tell wvstreams we need our own subtask
     uses_continue_select = true;
 
@@ -117,8 +136,9 @@ WvDialer::WvDialer( WvConf &_cfg, WvStringList *_sect_list, bool _chat_mode )
     brain = new WvDialBrain(this);
 
     // init_modem() reads the config options.  It MUST run here!
+    // Asynchronously, dial() initialises the modem, so only read them.
     
-    if(!init_modem())
+    if( async_init ? !load_modem_options() : !init_modem() )
     {
 	// init_modem() printed an error
 	stat = ModemError;
@@ -148,7 +168,15 @@ WvDialer::WvDialer( WvConf &_cfg, WvStringList *_sect_list, bool _chat_mode )
     
     pppd_mon.setdnstests(options.dnstest1, options.dnstest2);
     pppd_mon.setcheckdns(options.check_dns);
+    pppd_mon.setdnsserver(options.dns_server);
+    pppd_mon.setdnstimeout(options.dns_timeout);
     pppd_mon.setcheckdfr(options.check_dfr);
+    pppd_mon.setroutefile(options.route_file);
+    pppd_mon.set_event_fd(options.event_fd);
+    
+    if( !!options.control_socket && !control.listen( options.control_socket ) )
+	err( WvLog::Warning, "Cannot listen on %s: %s\n",
+	     options.control_socket, strerror( errno ) );
 }
 
 WvDialer::~WvDialer()
@@ -210,9 +238,10 @@ bool WvDialer::dial()
 	    }
 	}
     }
+    order_numbers();
 
     // we need to re-init the modem if we were online before.
-    if(been_online && !init_modem())
+    if( !async_init && been_online && !init_modem() )
 	stat = ModemError;
     else
     {
@@ -220,18 +249,28 @@ bool WvDialer::dial()
 	connect_attempts = 1;
 	dial_stat = 0;
 	brain->reset();
+	
+	// asynchronously, every dial starts with Init, which goes on to
+	// Dial once the modem is ready.
+	if( async_init )
+	    start_init();
     }
     
+    schedule_state();
     return(true);
 }
 
 void WvDialer::hangup()
 /*********************/
 {
+    bool pppd_ran = ( ppp_pipe != NULL );
+    
     WVRELEASE(ppp_pipe);
     
-    if( !chat_mode )
-      pppd_watch( 250 );
+    // whatever a dying pppd has said so far; its last words come through
+    // select() like the rest, so nobody sharing our loop waits for them.
+    if( !chat_mode && pppd_ran )
+      pppd_watch();
     
     if( stat != Idle ) 
     {
@@ -241,6 +280,21 @@ void WvDialer::hangup()
 	del_modem();
 	stat = Idle;
     }
+    
+    if( session.active() )
+	end_session();
+    capture.flush();
+
+    timers.cancel( SampleTimer );
+    if( sampler.running() )
+    {
+	WvDialLinkRates r;
+	if( sampler.rates( r ) )
+	    log( "Link averaged %s bytes/s in, %s bytes/s out, "
+		 "%s errors per 1000 packets.\n",
+		 (long)r.rx_bps, (long)r.tx_bps, (long)( r.error_rate * 1000 ) );
+	sampler.stop();
+    }
 
     if (messagetail_pid > 0) 
     {
@@ -252,37 +306,87 @@ void WvDialer::hangup()
 void WvDialer::pre_select( SelectInfo& si )
 /*******************************************/
 {
-    if( isok() && stat != Online && stat != Idle
-	&& time( NULL ) - last_execute > 1 )
-    {
-	// Pretend we have "data ready," so execute() gets called.
-	// select() already returns true whenever the modem is readable,
-	// but when we are doing a timeout (eg. PreDial1/2) for example,
-	// we need to execute() even if no modem data is incoming.
-	si.msec_timeout = 0;
-    } 
-    else 
+    WvStreamClone::pre_select( si );
+    
+    // about to sleep, so now is a good time to write out the logs.
+    WvDialLogQueue::flush_all();
+
+    // pppd's messages are read as they arrive, from the same select() as
+    // the modem's.
+    if( pppd_log && pppd_log->isok() )
+    {
+	SelectRequest oldwant = si.wants;
+	si.wants = SelectRequest( true );
+	pppd_log->pre_select( si );
+	si.wants = oldwant;
+    }
+    
+    // so is the DNS check, once it is running, and the control socket.
+    int dnsfd = pppd_mon.dns_fd();
+    if( dnsfd >= 0 )
     {
-	WvStreamClone::pre_select( si );
+	FD_SET( dnsfd, &si.read );
+	if( dnsfd > si.max_fd )
+	    si.max_fd = dnsfd;
+	long dms = pppd_mon.dns_msec_until( wvdial_msecs() );
+	if( si.msec_timeout < 0 || dms < si.msec_timeout )
+	    si.msec_timeout = dms;
     }
+    control.pre_select( si.read, si.max_fd );
+
+    // select() already returns true whenever the modem is readable, but
+    // when we are doing a timeout (eg. PreDial1/2) for example, we need to
+    // execute() even if no modem data is incoming.  So sleep no longer
+    // than the next registered deadline.
+    time_t ms = timers.msec_until( wvdial_msecs() );
+    if( ms >= 0 && ( si.msec_timeout < 0 || ms < si.msec_timeout ) )
+	si.msec_timeout = ms;
+
+    // on a virtual clock, only long enough for I/O to turn up.
+    si.msec_timeout = wvdial_clock().real_wait( si.msec_timeout );
 }
 
 
 bool WvDialer::post_select( SelectInfo& si )
+/******************************************/
 {
-    if( isok() && stat != Online && stat != Idle
-	&& time( NULL ) - last_execute > 1 )
+    bool ready = WvStreamClone::post_select( si );
+
+    if( pppd_log && pppd_log->isok() )
     {
-	// Pretend we have "data ready," so execute() gets called.
-	// select() already returns true whenever the modem is readable,
-	// but when we are doing a timeout (eg. PreDial1/2) for example,
-	// we need to execute() even if no modem data is incoming.
-	return true;
-    } 
-    else 
+	SelectRequest oldwant = si.wants;
+	si.wants = SelectRequest( true );
+	if( pppd_log->post_select( si ) )
+	    ready = true;
+	si.wants = oldwant;
+    }
+    
+    // queries are answered right here; only commands need execute().
+    if( control.post_select( si.read ) )
+	ready = true;
+    
+    int dnsfd = pppd_mon.dns_fd();
+    if( dnsfd >= 0 && FD_ISSET( dnsfd, &si.read ) )
+	ready = true;
+
+    // Nothing to do before the next deadline: on a virtual clock, that is
+    // where the time goes now.
+    WvDialMsec now = wvdial_msecs();
+    time_t ms  = timers.msec_until( now );
+    long   dms = dnsfd >= 0 ? pppd_mon.dns_msec_until( now ) : -1;
+    if( dms >= 0 && ( ms < 0 || dms < ms ) )
+	ms = dms;
+    if( !ready && ms > 0 )
     {
-	return WvStreamClone::post_select( si );
+	wvdial_clock().idle( ms );
+	ms = timers.msec_until( wvdial_msecs() );
+	if( dnsfd >= 0 && pppd_mon.dns_msec_until( wvdial_msecs() ) == 0 )
+	    ms = 0;
     }
+
+    // Pretend we have "data ready" when a deadline is due, so execute()
+    // gets called.
+    return( ready || ms == 0 );
 }
 
 
@@ -333,10 +437,13 @@ char *WvDialer::connect_status() const
     	strcpy( msg, N_("Waiting for a prompt from Internet Provider.") );
     	break;
     case AutoReconnectDelay:
-    	sprintf( msg, "Next attempt in 00:%02ld:%02ld.", 
-    		 ( auto_reconnect_at - time( NULL ) ) / 60,
-    		 ( auto_reconnect_at - time( NULL ) ) % 60 );
+    {
+	long secs = (long)( ( auto_reconnect_at - wvdial_msecs() + 999 ) / 1000 );
+	if( secs < 0 )
+	    secs = 0;
+    	sprintf( msg, "Next attempt in 00:%02ld:%02ld.", secs / 60, secs % 60 );
     	break;
+    }
     default:
     	return( NULL );
     }
@@ -344,24 +451,131 @@ char *WvDialer::connect_status() const
 }
 
 
-void WvDialer::pppd_watch( int ms )
-/*********************************/
+void WvDialer::pppd_watch()
+/*************************/
+// See if pppd has a message, analyse it and output to log.  Only reads what
+// has already arrived; once pppd has closed its end, so do we.
 {
-  // see if pppd has a message, analyse it and output to log
-  
     if( pppd_log != NULL && pppd_log->isok() ) 
     {
     	char *line;
     
-    	while ( (line = pppd_log->blocking_getline( ms )) )
+    	while ( (line = pppd_log->getline( 0 )) )
     	{
+	    capture.record( WvDialCapture::Pppd, line, strlen( line ) );
 	    WvString buffer1(pppd_mon.analyse_line( line ));
 	    if (!!buffer1)
 	    {
 	    	log("pppd: %s\n", buffer1);
     	    }
+	    
+	    if( pppd_mon.ip_up() && session.active() )
+	    {
+		if( number_stats.isok() && !!dialing )
+		    number_stats.ip_up( dialing, wvdial_msecs() - dial_sent_at );
+		session.mark( WvDialTimeline::IpUp );
+		end_session();
+	    }
         }
     }
+    if( pppd_log != NULL && !pppd_log->isok() )
+	WVRELEASE( pppd_log );
+}
+
+
+void WvDialer::run_command( WvDialControl::Command c )
+/***************************************************/
+// Do what the control socket asked for.
+{
+    switch( c )
+    {
+    case WvDialControl::Hangup:
+	log( WvLog::Notice, "Hanging up, as requested.\n" );
+	hangup();
+	break;
+    case WvDialControl::Redial:
+	log( WvLog::Notice, "Redialing, as requested.\n" );
+	hangup();
+	dial();
+	break;
+    case WvDialControl::NextNumber:
+	next_number();
+	log( WvLog::Notice, "Next number will be %s.\n",
+	     *phone( phnum_order[ phnum_count ] ) );
+	// if we are still waiting for a carrier, give up on this one.
+	if( stat == WaitDial )
+	{
+	    send( "\r" );
+	    stat = PreDial1;
+	}
+	break;
+    case WvDialControl::None:
+	break;
+    }
+}
+
+
+void WvDialer::sample_link( WvDialMsec now )
+/******************************************/
+// Take a sample of the ppp interface's counters, and schedule the next.
+// pppd only tells us which interface it is using once it is up, so keep
+// trying until it has.
+{
+    if( stat != Online || options.sample_interval <= 0 )
+	return;
+
+    const char *iface = pppd_mon.interface();
+    if( !sampler.running() && iface[0] && !sampler.start( iface ) )
+    {
+	err( WvLog::Warning, "Cannot read the statistics of %s; "
+	     "not sampling the link.\n", iface );
+	return;
+    }
+    
+    if( sampler.running() && !sampler.sample( now ) )
+	return;		// the interface is gone; pppd will be too
+
+    timers.set( SampleTimer, now + options.sample_interval * 1000 );
+}
+
+
+void WvDialer::end_session()
+/**************************/
+// Finish the current dial session, whether it made it to ip-up or not,
+// and write it to the "Timeline Log" and "Timeline Stats" files.
+{
+    session.stop();
+    session_stats.add( session );
+
+    if( !!options.timeline_log )
+    {
+	FILE *f = fopen( options.timeline_log, "a" );
+	if( f )
+	{
+	    fprintf( f, "%s\n", session.json().cstr() );
+	    fclose( f );
+	}
+	else
+	    err( WvLog::Warning, "Cannot write %s: %s\n",
+		 options.timeline_log, strerror( errno ) );
+    }
+
+    if( !!options.timeline_stats )
+    {
+	// write-and-rename, so a scraper never sees half a file
+	WvString tmp( "%s.tmp", options.timeline_stats );
+	FILE *f = fopen( tmp, "w" );
+	if( f )
+	{
+	    fprintf( f, "%s\n", session_stats.json().cstr() );
+	    fclose( f );
+	    if( rename( tmp, options.timeline_stats ) < 0 )
+		unlink( tmp );
+	}
+	else
+	    err( WvLog::Warning, "Cannot write %s: %s\n",
+		 tmp, strerror( errno ) );
+    }
 }
 
 
@@ -370,18 +584,53 @@ void WvDialer::execute()
 {
     WvStreamClone::execute();
     
+    if( !chat_mode )
+	pppd_watch();
+    
+    WvDialControl::Command cmd = control.take_command();
+    if( cmd != WvDialControl::None )
+	run_command( cmd );
+
+    // hung up: nothing more to do but listen to pppd's last words.
+    if( stat == Idle && ( cmd != WvDialControl::None || !modem ) )
+	return;
+    
     // the modem object might not exist, if we just disconnected and are
     // redialing.
-    if( !modem && !init_modem() )
+    if( !modem && async_init )
+    {
+	// the Init state opens it.
+	if( stat == Dial || stat == PreDial1 || stat == PreDial2 
+	    || stat == WaitDial )
+	    start_init();
+    }
+    else if( !modem && !init_modem() )
+    {
+	// try again shortly.
+	timers.set( StateTimer, wvdial_msecs() + 1000 );
     	return;
+    }
 
-    last_execute = time( NULL );
+    // Whatever woke us up, the state handlers below decide what the next
+    // deadline is.  Drop the old one so it can't cut a continue_select()
+    // short.
+    timers.cancel( StateTimer );
+    
+    WvDialMsec now = wvdial_msecs();
+    for( int id; ( id = timers.expire( now ) ) >= 0; )
+    {
+	if( id == SampleTimer )
+	    sample_link( now );
+    }
     
     if( !chat_mode )
-      pppd_watch( 100 );
+      pppd_mon.poll_dns();
     
     switch( stat ) 
     {
+    case Init:
+	async_init_modem();
+	break;
     case Dial:
     case WaitDial:
     case PreDial1:
@@ -390,13 +639,14 @@ void WvDialer::execute()
 	break;
     case WaitAnything:
 	// we allow some time after connection for silly servers/modems.
-	if( modem->select( 500, true, false ) ) 
+	if( modem_wait( 500 ) ) 
 	{
 	    // if any data comes in at all, switch to impatient mode.
+	    session.mark( WvDialTimeline::FirstByte );
 	    stat = WaitPrompt;
-	    last_rx = time( NULL );
+	    last_rx = wvdial_msecs();
 	} 
-	else if( time( NULL ) - last_rx >= 30 ) 
+	else if( wvdial_msecs() - last_rx >= 30000 ) 
 	{
 	    // timed out - do what WaitPrompt would do on a timeout.
 	    stat = WaitPrompt;
@@ -405,7 +655,7 @@ void WvDialer::execute()
 	{
 	    // We prod the server with a CR character every once in a while.
 	    // FIXME: Does this cause problems with login prompts?
-	    modem->write( "\r", 1 );
+	    send( "\r" );
 	}
 	break;
     case WaitPrompt:
@@ -428,7 +678,10 @@ void WvDialer::execute()
 	    hangup();
 	    del_modem();
 	    
-	    time_t call_duration = time( NULL ) - connected_at;
+	    WvDialMsec call_duration = wvdial_msecs() - connected_at;
+	    pppd_mon.emit( WvDialEvent::PppdExit, NULL, 0, pppd_exit_status );
+	    if( number_stats.isok() && !!dialing )
+		number_stats.online( dialing, call_duration );
 	    
 	    if( pppd_mon.auth_failed() ) 
 	    {
@@ -537,7 +790,7 @@ void WvDialer::execute()
 	    // check to see if we're supposed to redial automatically soon.
 	    if( options.auto_reconnect && isok() ) 
 	    {
-		if( call_duration >= 45 )
+		if( call_duration >= 45000 )
 		    // Connection was more than 45 seconds, so reset the
 		    // "exponential backup timer".
 		    auto_reconnect_delay = 0;
@@ -549,12 +802,11 @@ void WvDialer::execute()
 		if( auto_reconnect_delay > 600 )
 		    auto_reconnect_delay = 600;  // no longer than 10 minutes
 
-		auto_reconnect_at = time( NULL ) + auto_reconnect_delay;
+		auto_reconnect_at = wvdial_msecs() + 1000 * auto_reconnect_delay;
 
 		stat = AutoReconnectDelay;
 		log( WvLog::Notice, "Auto Reconnect will be attempted in %s "
-				    "seconds\n", 
-				    	auto_reconnect_at - time( NULL ) );
+				    "seconds\n", auto_reconnect_delay );
 	    }
 	}
 	break;
@@ -563,7 +815,7 @@ void WvDialer::execute()
     	// redial, do it...
     	// We can only get into this state if the Auto Reconnect option is
     	// enabled, so there's no point in checking the option here.
-    	if( time( NULL ) >= auto_reconnect_at ) 
+    	if( wvdial_msecs() >= auto_reconnect_at ) 
 	{
     	    stat = Idle;
     	    dial();
@@ -576,6 +828,80 @@ void WvDialer::execute()
 	drain();
     	break;
     }
+
+    schedule_state();
+}
+
+
+void WvDialer::schedule_state()
+/*****************************/
+// Register the deadline at which the current state next needs attention,
+// if nothing arrives from the modem before then.
+{
+    WvDialMsec now = wvdial_msecs();
+
+    switch( stat ) 
+    {
+    case Init:
+	timers.set( StateTimer, init_deadline );
+	break;
+    case Dial:
+    case PreDial1:
+    case PreDial2:
+	// these states do their own waiting; just get back to them.
+	timers.set( StateTimer, now );
+	break;
+    case WaitDial:
+	timers.set( StateTimer, last_rx + options.dial_timeout_ms );
+	break;
+    case WaitAnything:
+	// time to prod the server with another CR.
+	timers.set( StateTimer, now + 1000 );
+	break;
+    case WaitPrompt:
+	// check the carrier, and whether we have waited too long for a prompt.
+	timers.set( StateTimer, now + 1000 );
+	break;
+    case Online:
+	// see if pppd is still there.
+	timers.set( StateTimer, now + 1000 );
+	break;
+    case AutoReconnectDelay:
+	timers.set( StateTimer, auto_reconnect_at );
+	break;
+    case Idle:
+    case ModemError:
+    case OtherError:
+    default:
+	timers.cancel( StateTimer );
+	break;
+    }
+}
+
+
+void WvDialer::separate_files( WvConf &cfg, WvStringList &sections,
+			       WvStringParm tag )
+/*******************************************************************/
+{
+    static const char *per_dialer[] = {
+	"Control Socket", "Capture File", "Timeline Stats", NULL
+    };
+    const char * d = "Dialer Defaults";
+    WvString	 sect( "%s Files", tag );
+    WvString	 suffix( tag );
+
+    // "Dialer Foo Bar" -> "dialer-foo-bar"
+    for( char *p = suffix.edit(); *p; p++ )
+	*p = isalnum( (unsigned char)*p ) ? tolower( *p ) : '-';
+
+    for( int i = 0; per_dialer[i]; i++ )
+    {
+	WvString path = cfg.fuzzy_get( sections, per_dialer[i],
+				       cfg.get( d, per_dialer[i], "" ) );
+	if( !!path )
+	    cfg.set( sect, per_dialer[i], WvString( "%s.%s", path, suffix ) );
+    }
+    sections.prepend( new WvString( sect ), true );
 }
 
 
@@ -623,6 +949,13 @@ void WvDialer::load_options()
         { "DialMessage2",    &options.dialmessage2, NULL, "",		    0 },
         { "DNS Test1",       &options.dnstest1,     NULL, "www.suse.de",    0 },
         { "DNS Test2",       &options.dnstest2,     NULL, "www.suse.com",   0 },
+        { "DNS Server",      &options.dns_server,   NULL, "",		    0 },
+        { "Route Table File", &options.route_file,  NULL, "",		    0 },
+        { "Timeline Log",    &options.timeline_log, NULL, "",		    0 },
+        { "Timeline Stats",  &options.timeline_stats, NULL, "",		    0 },
+        { "Number Stats File", &options.number_stats, NULL, "",	    0 },
+        { "Control Socket",  &options.control_socket, NULL, "",	    0 },
+        { "Capture File",    &options.capture_file, NULL, "",		    0 },
 
     // int/bool options
     	{ "Baud",            NULL, &options.baud,          "", DEFAULT_BAUD },
@@ -637,11 +970,19 @@ void WvDialer::load_options()
         { "Tonline",         NULL, &options.tonline,       "", false        },
         { "Auto DNS",        NULL, &options.auto_dns,      "", true         },
         { "Check DNS",       NULL, &options.check_dns,     "", true         },
+        { "DNS Timeout",     NULL, &options.dns_timeout,   "", 10           },
         { "Check Def Route", NULL, &options.check_dfr,     "", true         },
+        { "Sample Interval", NULL, &options.sample_interval, "", 0          },
         { "Idle Seconds",    NULL, &options.idle_seconds,  "", 0            },
         { "ISDN",            NULL, &options.isdn,          "", false        },
         { "Ask Password",    NULL, &options.ask_password,  "", false        },
         { "Dial Timeout",    NULL, &options.dial_timeout,  "", 60           },
+        { "Dial Timeout ms", NULL, &options.dial_timeout_ms, "", 0          },
+        { "Prompt Timeout ms", NULL, &options.prompt_timeout_ms, "", 10000  },
+        { "Low Latency",     NULL, &options.low_latency,   "", false        },
+        { "Fast Redial",     NULL, &options.fast_redial,   "", false        },
+        { "Event FD",        NULL, &options.event_fd,      "", -1           },
+        { "Write Secrets",   NULL, &options.write_secrets, "", true         },
 
     	{ NULL,		     NULL, NULL,                   "", 0            }
     };
@@ -671,14 +1012,23 @@ void WvDialer::load_options()
 	                        cfg.get( d, "Init", NULL ) );
     if( newopt ) 
 	options.init1 = newopt;
+
+    // "Dial Timeout ms", if given, overrides the coarser "Dial Timeout".
+    if( options.dial_timeout_ms <= 0 )
+	options.dial_timeout_ms = options.dial_timeout * 1000;
 }
 
-bool WvDialer::init_modem()
-/*************************/
+bool WvDialer::load_modem_options()
+/*********************************/
+// Re-read the config, ready to open the modem.
 {
-    int	received, count;
-    
     load_options();
+    
+    // one capture covers every redial from here on.
+    if( !!options.capture_file && !capture.isok()
+	&& !capture.create( options.capture_file ) )
+	err( WvLog::Warning, "Cannot write %s: %s\n",
+	     options.capture_file, strerror( errno ) );
 
     if (!options.modem) 
     {
@@ -686,11 +1036,25 @@ bool WvDialer::init_modem()
     	stat = ModemError;
 	return( false ); // if we get this error, we already have a problem.
     }
+    return( true );
+}
+
+bool WvDialer::init_modem()
+/*************************/
+{
+    int	received, count;
+    
+    if( !load_modem_options() )
+	return( false );
     
     for (count = 0; count < 3; count++)
     {
 	// the buffer is empty.
-	offset = 0;
+	rxbuf.clear();
+	
+	// a new dial session starts when we first open the modem for it.
+	if( !session.active() )
+	    session.start();
     
 	del_modem();
 	
@@ -734,47 +1098,38 @@ bool WvDialer::init_modem()
 	    continue;
 	}
 	
+	if( count == 0 && quick_init() )
+	    return( true );
+	
 	log( "Initializing modem.\n" );
+	session.mark( WvDialTimeline::ModemOpen );
 	
 	// make modem happy
-	modem->print( "\r\r\r\r\r" );
-	while( modem->select( 100, true, false ) )
+	send( "\r\r\r\r\r" );
+	while( modem_wait( 100 ) )
 	    modem->drain();
 	
 	// Send up to nine init strings, in order.
 	int	init_count;
 	for( init_count=1; init_count<=9; init_count++ ) 
 	{
-	    WvString *this_str;
-	    switch( init_count ) 
-	    {
-	    case 1:    this_str = &options.init1;	break;
-	    case 2:    this_str = &options.init2;	break;
-	    case 3:    this_str = &options.init3;	break;
-	    case 4:    this_str = &options.init4;	break;
-	    case 5:    this_str = &options.init5;	break;
-	    case 6:    this_str = &options.init6;	break;
-	    case 7:    this_str = &options.init7;	break;
-	    case 8:    this_str = &options.init8;	break;
-	    case 9:
-	    default:
-		this_str = &options.init9;	break;
-	    }
+	    WvString *this_str = init_string( init_count );
 	    if( !! *this_str ) 
 	    {
-		modem->print( "%s\r", *this_str );
+		send( WvString( "%s\r", *this_str ) );
 		log( "Sending: %s\n", *this_str );
+		session.mark( WvDialTimeline::InitSent, init_count );
 		
-		received = wait_for_modem( init_responses, 5000, true );
+		received = wait_for_modem( init_matcher, 5000, true );
 		switch( received ) 
 		{
 		case -1:
-		    modem->print( "ATQ0\r" );
+		    send( "ATQ0\r" );
 		    log( "Sending: ATQ0\n" );
-		    received = wait_for_modem( init_responses, 500, true );
-		    modem->print( "%s\r", *this_str );
+		    received = wait_for_modem( init_matcher, 500, true );
+		    send( WvString( "%s\r", *this_str ) );
 		    log( "Re-Sending: %s\n", *this_str );
-		    received = wait_for_modem( init_responses, 5000, true );
+		    received = wait_for_modem( init_matcher, 5000, true );
 		    switch( received ) 
 		    {
 			case -1:
@@ -789,11 +1144,13 @@ bool WvDialer::init_modem()
 		    err( "Bad init string.\n" );
 		    goto end_outer;
 		}
+		session.mark( WvDialTimeline::InitAnswered, init_count );
 	    }
 	}
 
 	// Everything worked fine.
 	log( "Modem initialized.\n" );
+	init_fingerprint = modem_fingerprint();
 	return( true );
 	
 	// allows us to exit the internal loop
@@ -806,6 +1163,245 @@ bool WvDialer::init_modem()
 }
 
 
+WvString WvDialer::modem_fingerprint() const
+/*******************************************/
+// Everything init_modem() sends to, or sets on, the modem.
+{
+    return( WvString( "%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s",
+		      options.modem, options.baud, chat_mode,
+		      options.init1, options.init2, options.init3,
+		      options.init4, options.init5, options.init6,
+		      options.init7, options.init8, options.init9 ) );
+}
+
+
+WvString *WvDialer::init_string( int which )
+/******************************************/
+{
+    switch( which ) 
+    {
+    case 1:	return( &options.init1 );
+    case 2:	return( &options.init2 );
+    case 3:	return( &options.init3 );
+    case 4:	return( &options.init4 );
+    case 5:	return( &options.init5 );
+    case 6:	return( &options.init6 );
+    case 7:	return( &options.init7 );
+    case 8:	return( &options.init8 );
+    case 9:
+    default:	return( &options.init9 );
+    }
+}
+
+
+bool WvDialer::can_quick_init() const
+/***********************************/
+// When redialing with "Fast Redial", the modem is usually still set up the
+// way the Init strings left it, so a single AT/OK is enough to check that
+// it is alive.
+{
+    return( options.fast_redial && been_online && !!init_fingerprint
+	    && init_fingerprint == modem_fingerprint() );
+}
+
+
+bool WvDialer::quick_init()
+/*************************/
+// Returns false if a full initialisation is needed.
+{
+    if( !can_quick_init() )
+	return( false );
+
+    log( "Checking modem.\n" );
+    session.mark( WvDialTimeline::ModemOpen );
+    
+    send( "\rAT\r" );
+    if( wait_for_modem( init_matcher, 1000, true ) != 0 )
+    {
+	log( "No answer; re-initializing.\n" );
+	rxbuf.clear();
+	return( false );
+    }
+    
+    log( "Modem ready.\n" );
+    return( true );
+}
+
+
+void WvDialer::start_init()
+/*************************/
+// Go to the Init state, which goes on to Dial once the modem is ready.
+{
+    del_modem();
+    stat	  = Init;
+    init_step	  = InitOpen;
+    init_try	  = 0;
+    init_deadline = wvdial_msecs();
+}
+
+
+void WvDialer::init_failed( bool retry )
+/**************************************/
+// Like init_modem(), give up after the third try.
+{
+    if( retry && ++init_try < 3 )
+    {
+	init_step     = InitOpen;
+	init_deadline = wvdial_msecs() + 1000;
+    }
+    else
+	stat = ModemError;
+}
+
+
+void WvDialer::wake_modem()
+/*************************/
+{
+    log( "Initializing modem.\n" );
+    session.mark( WvDialTimeline::ModemOpen );
+    
+    // make modem happy
+    send( "\r\r\r\r\r" );
+    init_step     = InitWake;
+    init_deadline = wvdial_msecs() + 100;
+}
+
+
+void WvDialer::send_init( int which )
+/***********************************/
+// Send the first Init string from 'which' on that is set, or go on to Dial
+// if there are no more.
+{
+    for( ; which <= 9; which++ )
+    {
+	WvString *this_str = init_string( which );
+	if( !*this_str )
+	    continue;
+	
+	send( WvString( "%s\r", *this_str ) );
+	log( "Sending: %s\n", *this_str );
+	session.mark( WvDialTimeline::InitSent, which );
+	init_num      = which;
+	init_resent   = false;
+	init_step     = InitWait;
+	init_deadline = wvdial_msecs() + 5000;
+	return;
+    }
+    
+    log( "Modem initialized.\n" );
+    init_fingerprint = modem_fingerprint();
+    stat = Dial;
+}
+
+
+void WvDialer::async_init_modem()
+/*******************************/
+// What init_modem() does, without ever waiting: each call deals with
+// whatever the modem has said, and leaves init_deadline at when to come
+// back if it says nothing more.
+{
+    WvDialMsec now = wvdial_msecs();
+    int	       received;
+    
+    switch( init_step ) 
+    {
+    case InitOpen:
+	if( now < init_deadline )
+	    return;
+	
+	rxbuf.clear();
+	if( !session.active() )
+	    session.start();
+	
+	del_modem();
+	cloned = modem = new WvModem( options.modem, options.baud );
+	if( !modem->isok() ) 
+	{
+	    err( "Cannot open %s: %s\n", options.modem, modem->errstr() );
+	    del_modem();
+	    init_failed( true );
+	    return;
+	}
+	
+	if( init_try == 0 && can_quick_init() )
+	{
+	    log( "Checking modem.\n" );
+	    session.mark( WvDialTimeline::ModemOpen );
+	    send( "\rAT\r" );
+	    init_step     = InitCheck;
+	    init_deadline = now + 1000;
+	}
+	else
+	    wake_modem();
+	return;
+	
+    case InitCheck:
+	received = async_wait_for_modem( init_matcher, true );
+	if( received == 0 )
+	{
+	    log( "Modem ready.\n" );
+	    stat = Dial;
+	}
+	else if( received > 0 || now >= init_deadline )
+	{
+	    log( "No answer; re-initializing.\n" );
+	    rxbuf.clear();
+	    wake_modem();
+	}
+	return;
+	
+    case InitWake:
+	// wait for the modem to stop talking.
+	if( modem->select( 0, true, false ) )
+	{
+	    modem->drain();
+	    init_deadline = now + 100;
+	}
+	else if( now >= init_deadline )
+	    send_init( 1 );
+	return;
+	
+    case InitWait:
+	received = async_wait_for_modem( init_matcher, true );
+	if( received == 0 )
+	{
+	    session.mark( WvDialTimeline::InitAnswered, init_num );
+	    send_init( init_num + 1 );
+	}
+	else if( received == 1 )
+	{
+	    err( "Bad init string.\n" );
+	    init_failed( !init_resent );
+	}
+	else if( now >= init_deadline && init_resent )
+	{
+	    err( "Modem not responding.\n" );
+	    init_failed( false );
+	}
+	else if( now >= init_deadline )
+	{
+	    send( "ATQ0\r" );
+	    log( "Sending: ATQ0\n" );
+	    init_step     = InitQuiet;
+	    init_deadline = now + 500;
+	}
+	return;
+	
+    case InitQuiet:
+	received = async_wait_for_modem( init_matcher, true );
+	if( received < 0 && now < init_deadline )
+	    return;
+	
+	send( WvString( "%s\r", *init_string( init_num ) ) );
+	log( "Re-Sending: %s\n", *init_string( init_num ) );
+	init_resent   = true;
+	init_step     = InitWait;
+	init_deadline = wvdial_msecs() + 5000;
+	return;
+    }
+}
+
+
 void WvDialer::del_modem()
 {
     assert(cloned == modem);
@@ -819,6 +1415,15 @@ void WvDialer::del_modem()
 }
 
 
+void WvDialer::send( const char *buf, size_t len )
+/************************************************/
+// Everything for the modem goes through here, so it can be captured.
+{
+    capture.record( WvDialCapture::Tx, buf, len );
+    modem->write( buf, len );
+}
+
+
 WvModemBase *WvDialer::take_modem()
 {
     WvModemBase *_modem;
@@ -840,6 +1445,111 @@ void WvDialer::give_modem(WvModemBase *_modem)
 }
 
 
+WvString *WvDialer::phone( int which )
+/************************************/
+{
+    switch( which ) 
+    {  
+    case 0:	return( &options.phnum );
+    case 1:	return( &options.phnum1 );
+    case 2:	return( &options.phnum2 );
+    case 3:	return( &options.phnum3 );
+    case 4:
+    default:	return( &options.phnum4 );
+    }
+}
+
+
+void WvDialer::order_numbers()
+/****************************/
+// With a "Number Stats File", dial the numbers in order of how long each
+// has taken, on average, to get a CONNECT.  Otherwise, in the usual order.
+{
+    for( int i = 0; i < 5; i++ )
+	phnum_order[i] = i;
+
+    if( !options.number_stats )
+    {
+	number_stats.close();
+	return;
+    }
+
+    if( !number_stats.isok() || number_stats.filename() != options.number_stats )
+    {
+	if( !number_stats.open( options.number_stats ) )
+	{
+	    err( WvLog::Warning, "Cannot open %s: %s\n", 
+		 options.number_stats, strerror( errno ) );
+	    return;
+	}
+    }
+
+    long long expected[5];
+    for( int i = 0; i <= phnum_max; i++ )
+	expected[i] = number_stats.expected_ms( *phone( i ) );
+
+    // a stable insertion sort, so ties keep the order from the config.
+    for( int i = 1; i <= phnum_max; i++ )
+    {
+	int which = phnum_order[i];
+	int j;
+	for( j = i; j > 0 && expected[ phnum_order[j-1] ] > expected[which]; j-- )
+	    phnum_order[j] = phnum_order[j-1];
+	phnum_order[j] = which;
+    }
+    phnum_count = 0;
+
+    // each racer starts its own way down the list.
+    if( race_offset > 0 && phnum_max > 0 )
+    {
+	int sorted[5];
+	for( int i = 0; i <= phnum_max; i++ )
+	    sorted[i] = phnum_order[i];
+	for( int i = 0; i <= phnum_max; i++ )
+	    phnum_order[i] = sorted[ ( i + race_offset ) % ( phnum_max + 1 ) ];
+    }
+
+    if( phnum_max > 0 )
+	log( "%s number: %s\n", race_offset ? "First" : "Best",
+	     *phone( phnum_order[0] ) );
+}
+
+
+bool WvDialer::next_number()
+/**************************/
+// Move on to the next phone number.  Returns false if that wrapped around
+// to the first one.
+{
+    if( phnum_count++ == phnum_max )
+	phnum_count = 0;
+    return( phnum_count != 0 );
+}
+
+
+void WvDialer::record_attempt( int result )
+/*****************************************/
+// Note how the last dial attempt went.  With statistics being kept, any
+// failure that says something about the number rather than the line also
+// moves us on to the next one, as BUSY always has.
+{
+    if( !number_stats.isok() || !dialing )
+	return;
+
+    number_stats.attempt( dialing, result, wvdial_msecs() - dial_sent_at );
+
+    switch( result )
+    {
+    case 1:	// timed out
+    case 2:	// NO CARRIER
+    case 5:	// VOICE
+    case 6:	// FCLASS
+    case 7:	// NO ANSWER
+	next_number();
+	break;
+    }
+}
+
+
 void WvDialer::async_dial()
 /*************************/
 {
@@ -848,7 +1558,7 @@ void WvDialer::async_dial()
     if( stat == PreDial2 ) 
     {
     	// Wait for three seconds and then go to PreDial1.
-    	continue_select(3000);
+    	pause( 3000 );
     	stat = PreDial1;
     	return;
     }
@@ -858,8 +1568,8 @@ void WvDialer::async_dial()
 	// Hit enter a few times.
 	for( int i=0; i<3; i++ ) 
 	{
-	    modem->write( "\r", 1 );
-	    continue_select(500);
+	    send( "\r" );
+	    pause( 500 );
 	    if (!isok() || !modem)
 		break;
 	}
@@ -871,50 +1581,35 @@ void WvDialer::async_dial()
     {
     	// Construct the dial string.  We use the dial command, prefix,
 	// area code, and phone number as specified in the config file.
-	WvString *this_str;
-        switch( phnum_count ) 
-	{  
-            case 0:     
-		this_str = &options.phnum;
-		break;
-            case 1:     
-		this_str = &options.phnum1;
-		break;
-            case 2:     
-		this_str = &options.phnum2;     
-		break;
-            case 3:     
-		this_str = &options.phnum3;     
-		break;
-            case 4:
-            default:
-                this_str = &options.phnum4;     
-		break;
-        }
+	WvString *this_str = phone( phnum_order[ phnum_count ] );
 
 	WvString s( "%s%s%s%s%s\r", options.dial_cmd,
 				 options.dial_prefix,
 				 !options.dial_prefix ? "" : ",",
 				 options.areacode,
 				 *this_str );
-	modem->print( s );
+	send( s );
 	log( "Sending: %s\n", s );
 	log( "Waiting for carrier.\n" );
+	session.mark( WvDialTimeline::DialSent, phnum_count + 1 );
+	dialing      = *this_str;
+	dial_sent_at = wvdial_msecs();
 
 	stat = WaitDial;
     }
 
-    received = async_wait_for_modem( dial_responses, true );
+    received = async_wait_for_modem( dial_matcher, true );
     
     switch( received ) 
     {
     case -1:	// nothing -- return control.
-	if( time( NULL ) - last_rx  >= options.dial_timeout ) 
+	if( wvdial_msecs() - last_rx  >= options.dial_timeout_ms ) 
 	{
 	    log( WvLog::Warning, "Timed out while dialing.  Trying again.\n" );
 	    stat = PreDial1;
 	    connect_attempts++;
 	    dial_stat = 1;
+	    record_attempt( dial_stat );
 	    
 	    //if Attempts in wvdial.conf is 0..dont do anything
 	    if(options.dial_attempts != 0)
@@ -928,6 +1623,8 @@ void WvDialer::async_dial()
 	}
 	return;
     case 0:	// CONNECT
+	session.mark( WvDialTimeline::Connect );
+	record_attempt( 0 );
 	
         /*
         if( chat_mode ) 
@@ -979,7 +1676,8 @@ void WvDialer::async_dial()
 	stat = PreDial1;
 	connect_attempts++;
 	dial_stat = 2;
-	continue_select(2000);
+	record_attempt( dial_stat );
+	pause( 2000 );
 
 	//if Attempts in wvdial.conf is 0..dont do anything
 	if(options.dial_attempts != 0)
@@ -1004,6 +1702,7 @@ void WvDialer::async_dial()
 	    stat = PreDial2;
 	    connect_attempts++;
 	    dial_stat = 3;
+	    record_attempt( dial_stat );
             //if Attempts in wvdial.conf is 0..dont do anything
             if(options.dial_attempts != 0)
 	    {
@@ -1022,16 +1721,15 @@ void WvDialer::async_dial()
 	} 
 	else 
 	{
-	    if( phnum_count++ == phnum_max )
-		phnum_count = 0;
-	    if( phnum_count == 0 )
+	    if( !next_number() )
 		log( WvLog::Warning, "The line is busy. Trying again.\n" );
 	    else
 		log( WvLog::Warning, "The line is busy. Trying other number.\n");
 	    stat = PreDial1;
 	    connect_attempts++;
 	    dial_stat = 4;
-	    continue_select(2000);
+	    record_attempt( dial_stat );
+	    pause( 2000 );
 	}
 	return;
     case 5:	// ERROR
@@ -1050,6 +1748,7 @@ void WvDialer::async_dial()
 	log( "Voice line detected.  Trying again.\n" );
 	connect_attempts++;
 	dial_stat = 5;
+	record_attempt( dial_stat );
 	stat = PreDial2;
 	
 	//if Attempts in wvdial.conf is 0..dont do anything
@@ -1066,6 +1765,7 @@ void WvDialer::async_dial()
 	log( "Fax line detected.  Trying again.\n" );
 	connect_attempts++;
 	dial_stat = 6;
+	record_attempt( dial_stat );
 	stat = PreDial2;
 	if(options.dial_attempts != 0)
 	{
@@ -1081,6 +1781,7 @@ void WvDialer::async_dial()
         stat = PreDial1;
         connect_attempts++;
         dial_stat = 7;
+	record_attempt( dial_stat );
         if(options.dial_attempts != 0)
 	{
             if(check_attempts_exceeded(connect_attempts))
@@ -1088,7 +1789,7 @@ void WvDialer::async_dial()
 		hangup();
             }
         }
-        continue_select(2000);
+        pause( 2000 );
         return;
     default:
 	err( "Unknown dial response string.\n" );
@@ -1148,6 +1849,7 @@ int WvDialer::ask_password()
     char tmp[60];
     
     log("Please enter password (or empty password to stop):\n" );
+    WvDialLogQueue::flush_all();
     //  fflush( stdout );		// kinternet needs this - WvLog should do it
     // automagically
     // 
@@ -1169,6 +1871,9 @@ void WvDialer::start_ppp()
 {
     if( chat_mode ) exit(0); // pppd is already started...
     
+    session.mark( WvDialTimeline::StartPPP );
+    pppd_mon.reset();
+    
     WvString	addr_colon( "%s:", options.force_addr );
     WvString	speed( options.baud );
     WvString	idle_seconds( options.idle_seconds );
@@ -1184,6 +1889,7 @@ void WvDialer::start_ppp()
 	err("pipe failed: %s\n", strerror(errno) );
 	exit( EXIT_FAILURE );
     }
+    WVRELEASE( pppd_log );
     pppd_log = new WvFDStream( pppd_msgfd[0] );
     WvString buffer1("%s", pppd_msgfd[1] );
     
@@ -1264,29 +1970,39 @@ void WvDialer::start_ppp()
     
     // PP - Put this back in, since we're not using passwordfd unless we're
     // SuSE... how did this work without this?
-    WvPapChap   papchap;
-    papchap.put_secret( options.login, options.password, options.remote );
-    if( papchap.isok_pap() == false ) 
+    if( options.write_secrets )
     {
-        err( "Warning: Could not modify %s: %s\n"
-             "--> PAP (Password Authentication Protocol) may be flaky.\n",
-             PAP_SECRETS, strerror( errno ) );
-    }
-    if( papchap.isok_chap() == false ) 
-    {
-        err( "Warning: Could not modify %s: %s\n"
-             "--> CHAP (Challenge Handshake) may be flaky.\n",
-             CHAP_SECRETS, strerror( errno ) );
+	WvPapChap   papchap;
+	papchap.put_secret( options.login, options.password, options.remote );
+	if( papchap.isok_pap() == false ) 
+	{
+	    err( "Warning: Could not modify %s: %s\n"
+		 "--> PAP (Password Authentication Protocol) may be flaky.\n",
+		 PAP_SECRETS, strerror( errno ) );
+	}
+	if( papchap.isok_chap() == false ) 
+	{
+	    err( "Warning: Could not modify %s: %s\n"
+		 "--> CHAP (Challenge Handshake) may be flaky.\n",
+		 CHAP_SECRETS, strerror( errno ) );
+	}
     }
  
     ppp_pipe = new WvPipe( argv[0], argv, false, false, false,
 			   modem, modem, modem );
+    
+    // only pppd writes to the message pipe, so we see EOF when it exits.
+    ::close( pppd_msgfd[1] );
 
     log( WvLog::Notice, "Pid of pppd: %s\n", ppp_pipe->getpid() );
+    session.mark( WvDialTimeline::PppdSpawned );
 
     stat 	 = Online;
     been_online  = true;
-    connected_at = time( NULL );
+    connected_at = wvdial_msecs();
+    
+    if( options.sample_interval > 0 )
+	timers.set( SampleTimer, connected_at + options.sample_interval * 1000 );
 }
 
 void WvDialer::async_waitprompt()
@@ -1305,7 +2021,7 @@ void WvDialer::async_waitprompt()
 	}
     }
     
-    received = async_wait_for_modem( prompt_strings, false, true );
+    received = async_wait_for_modem( prompt_matcher, false, true );
     if( received >= 0 ) 
     {
 	// We have a PPP sequence!
@@ -1320,117 +2036,157 @@ void WvDialer::async_waitprompt()
     	// check to see if we are at a prompt.
         // Note: the buffer has been lowered by strlwr() already.
 
-	prompt_response = brain->check_prompt( buffer );
+	prompt_response = brain->check_prompt( rxbuf.str() );
 	if( prompt_response != NULL )
-	    modem->print( "%s\r", prompt_response );
+	{
+	    send( WvString( "%s\r", prompt_response ) );
+	    session.mark( WvDialTimeline::PromptResponse );
+	}
     }
 }
 
 
-static void strip_parity( char * buf, size_t size )
-/*************************************************/
-// clear the parity bit on incoming data (to allow 7e1 connections)
+bool WvDialer::modem_wait( time_t ms )
+/************************************/
+// Wait up to 'ms' on wvdial's clock for the modem to say something.
 {
-    while( size-- > 0 )
-    {
-	*buf = *buf & 0x7f;
-	buf++;
-    }
+    WvDialClock &clock = wvdial_clock();
+
+    if( modem->select( clock.real_wait( ms ), true, false ) )
+	return( true );
+    clock.idle( ms );
+    return( false );
+}
+
+
+void WvDialer::pause( time_t ms )
+/*******************************/
+// Sit out a fixed delay on wvdial's clock, letting the rest of the
+// program run meanwhile.
+{
+    WvDialClock &clock = wvdial_clock();
+
+    continue_select( clock.real_wait( ms ) );
+    clock.idle( ms );
 }
 
 
-int WvDialer::wait_for_modem( const char * strs[], 
+int WvDialer::wait_for_modem( const WvDialMatcher &responses, 
 			      int	timeout, 
 			      bool	neednewline,
 			      bool 	verbose )
 /***********************************************/
 {
-    off_t	onset;
-    char *	soff;
+    char	chunk[ INBUF_SIZE ];
+    char	lower[ INBUF_SIZE ];
+    size_t	len;
     int		result = -1;
-    int		len;
     const char *ppp_marker = NULL;
 
-    while( modem->select( timeout, true, false ) ) 
+    // we may be in for a wait; let the log catch up first.
+    WvDialLogQueue::flush_all();
+    
+    while( modem_wait( timeout ) ) 
     {
-	last_rx = time( NULL );
-	onset = offset;
-	offset += modem->read( buffer + offset, INBUF_SIZE - offset );
+	last_rx = wvdial_msecs();
+	len = modem->read( chunk, INBUF_SIZE );
 	
 	// make sure we do not split lines TOO arbitrarily, or the
-	// logs will look bad.
-	while( offset < INBUF_SIZE && modem->select( 100, true, false ) )
-	    offset += modem->read( buffer + offset, INBUF_SIZE - offset );
+	// logs will look bad.  In low latency mode we match on every read
+	// as it arrives, and log_modem() puts the lines back together.
+	while( !options.low_latency 
+	       && len < INBUF_SIZE && modem_wait( 100 ) )
+	    len += modem->read( chunk + len, INBUF_SIZE - len );
 	
-	// Make sure there is a NULL on the end of the buffer.
-	buffer[ offset ] = '\0';
+	capture.record( WvDialCapture::Rx, chunk, len );
 	
-	// Now turn all the NULLs in the middle of the buffer to spaces, for
-	// easier parsing.
-	replace_char( buffer + onset, '\0', ' ', offset - onset );
-	strip_parity( buffer + onset, offset - onset );
-	replace_char( buffer + onset, '\0', ' ', offset - onset );
+	// Strip the parity and turn all the NULLs to spaces, for easier
+	// parsing; the matcher and the brain want a lowercase copy.
+	wvdial_normalise( chunk, chunk, lower, len );
 	
 	if( verbose )
-	    modemrx.write( buffer + onset, offset - onset );
+	    log_modem( chunk, len );
 	
-	strlwr( buffer + onset );
+	rxbuf.append( lower, len );
 	
-	// Now we can search using strstr.
-	for( result = 0; strs[ result ] != NULL; result++ )
-	{
-	    len = strlen( strs[ result ] );
-	    soff = strstr( buffer, strs[ result ] );
-	    
-	    if( soff && ( !neednewline 
-			  || strchr( soff, '\n' ) || strchr( soff, '\r' ) ) )
-	    {
-		memmove( buffer, soff + len,
-			 offset - (int)( soff+len - buffer ) );
-		offset -= (int)( soff+len - buffer );
-		break;
-	    }
-	}
-	
-	if( strs[ result ] == NULL )
-	    result = -1;
+	// Now we can search the new data.  A match consumes the buffer up
+	// to its end.
+	result = rxbuf.match( responses, neednewline );
 	
 	// Search the buffer for a valid menu option...
-	// If guess_menu returns an offset, we zap everything before it in
-	// the buffer.  This prevents finding the same menu option twice.
-	ppp_marker = brain->guess_menu( buffer );
-	if (strs != dial_responses) 
+	// If guess_menu returns an offset, we consume everything before it
+	// in the buffer.  This prevents finding the same menu option twice.
+	ppp_marker = brain->guess_menu( rxbuf.str() );
+	if (&responses != &dial_matcher) 
 	{
 	    if( ppp_marker != NULL )
-		memset( buffer, ' ', ppp_marker-buffer );
-	}
-	
-	// Looks like we didn't find anything.  Is the buffer full yet?
-	if( offset == INBUF_SIZE ) 
-	{
-	    // yes, move the second half to the first half for next time.
-	    memmove( buffer, buffer + INBUF_SIZE/2,
-		     INBUF_SIZE - INBUF_SIZE/2 );
-	    offset = INBUF_SIZE/2;
+		rxbuf.consume_to( ppp_marker );
 	}
 	
 	if( result != -1 )
 	    break;
     }
     
-    buffer[ offset ] = 0;
+    // the modem went quiet: show whatever is left of the line (usually
+    // a prompt).
+    if( result == -1 )
+	flush_modem_log();
+
     return( result ); // -1 == timeout
 }
 
-int WvDialer::async_wait_for_modem( const char * strs[], bool neednl, bool verbose )
-/****************************************************************************/
+
+void WvDialer::log_modem( const char * data, size_t len )
+/*******************************************************/
+// Log modem input a whole line at a time, however it was split up by the
+// reads.
+{
+    if( !options.low_latency ) 
+    {
+	modemrx.write( data, len );
+	return;
+    }
+
+    while( len > 0 ) 
+    {
+	const char * nl = (const char *)memchr( data, '\n', len );
+	size_t n = nl ? nl - data + 1 : len;
+
+	if( rxline_len + n > INBUF_SIZE )
+	    flush_modem_log();
+	if( n > INBUF_SIZE )
+	    modemrx.write( data, n );
+	else 
+	{
+	    memcpy( rxline + rxline_len, data, n );
+	    rxline_len += n;
+	}
+	if( nl )
+	    flush_modem_log();
+
+	data += n;
+	len -= n;
+    }
+}
+
+
+void WvDialer::flush_modem_log()
+/******************************/
+{
+    if( rxline_len )
+	modemrx.write( rxline, rxline_len );
+    rxline_len = 0;
+}
+
+int WvDialer::async_wait_for_modem( const WvDialMatcher &responses, 
+				    bool neednl, bool verbose )
+/***************************************************************/
 {
-    return( wait_for_modem( strs, 10, neednl, verbose ) );
+    return( wait_for_modem( responses, 10, neednl, verbose ) );
 }
 
 void WvDialer::reset_offset()
 /***************************/
 {
-    offset = 0;
-    buffer[0] = '\0';
+    rxbuf.clear();
 }
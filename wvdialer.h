@@ -20,6 +20,14 @@
 #include "wvpipe.h"
 #include "wvstreamclone.h"
 #include "wvdialmon.h"
+#include "wvdialtimer.h"
+#include "wvdialrxbuf.h"
+#include "wvdialtrace.h"
+#include "wvdialstats.h"
+#include "wvdialsampler.h"
+#include "wvdialcontrol.h"
+#include "wvdiallog.h"
+#include "wvdialcapture.h"
 
 #define INBUF_SIZE	1024
 #define DEFAULT_BAUD	57600U
@@ -38,12 +46,17 @@ struct OptInfo
 };
 
 class WvConf;
+class WvDialMatcher;
 
 class WvDialer : public WvStreamClone
 /***********************************/
 {
 public:
-    WvDialer( WvConf &_cfg, WvStringList *_sect_list, bool _chat_mode = false );
+    // With '_async_init', the constructor leaves the modem alone and dial()
+    // initialises it from execute(), so a dialer sharing an event loop
+    // with others never keeps them waiting.
+    WvDialer( WvConf &_cfg, WvStringList *_sect_list, bool _chat_mode = false,
+	      bool _async_init = false );
     virtual ~WvDialer();
    
     bool	dial();
@@ -52,7 +65,7 @@ public:
    
     bool check_attempts_exceeded(int connect_attempts);
 
-    void	pppd_watch( int w );
+    void	pppd_watch();
    
     int         ask_password();
    
@@ -67,14 +80,15 @@ public:
 	WaitDial,
 	WaitAnything,
 	WaitPrompt,
-	AutoReconnectDelay
+	AutoReconnectDelay,
+	Init
     };
 
     Status status() const
         { return stat; }
    
     time_t auto_reconnect_time() const
-        { return (auto_reconnect_at - time(NULL)); }
+        { return (auto_reconnect_at - wvdial_msecs()) / 1000; }
    
     virtual void pre_select(SelectInfo &si);
     virtual bool post_select(SelectInfo &si);
@@ -88,7 +102,42 @@ public:
     WvModemBase *take_modem();
     void give_modem(WvModemBase *_modem);
    
+    // Write to the modem, and to the "Capture File" if there is one.
+    void	send( const char *buf, size_t len );
+    void	send( WvStringParm s )
+        { send( s.cstr(), s.len() ); }
+   
+    // Timing of the current (or last) dial session, and of all of them.
+    const WvDialTimeline &timeline() const
+        { return session; }
+    const WvDialPhaseStats &phase_stats() const
+        { return session_stats; }
+   
+    // Throughput and errors of the PPP link, sampled every "Sample
+    // Interval" seconds while online.  The samples of the last connection
+    // stay available after it ends.
+    const WvDialSampler &link_stats() const
+        { return sampler; }
+   
+    // For racing modems: with a "Number Stats File", start this many
+    // numbers down the best-first list, so they don't all dial the same
+    // one.  (Without one, WvDialRace rotates the numbers itself.)
+    void set_race_offset( int n )
+        { race_offset = n; }
+   
+    // For a dialer that runs alongside others from the same config
+    // (WvDialRace, WvDialFleet): puts a section in front of 'sections' that
+    // adds ".<tag>" to the Control Socket, Capture File and Timeline Stats
+    // paths, so each dialer has files of its own.
+    static void separate_files( WvConf &cfg, WvStringList &sections,
+				WvStringParm tag );
+   
+    // The prompt and menu guesser, to try it out on its own.
+    WvDialBrain &prompt_brain()
+        { return *brain; }
+   
     friend class WvDialBrain;
+    friend class WvDialControl;
    
     struct {
 	WvString	        modem;
@@ -126,6 +175,14 @@ public:
 	WvString         dialmessage1;
 	WvString         dialmessage2;
 	WvString         dnstest1, dnstest2;
+	WvString         dns_server;
+	int              dns_timeout;
+	WvString         route_file;
+	WvString         timeline_log;
+	WvString         timeline_stats;
+	WvString         number_stats;
+	WvString         control_socket;
+	WvString         capture_file;
 	int              carrier_check;
 	int		stupid_mode;
 	int		new_pppd;
@@ -142,6 +199,13 @@ public:
 	int              isdn;
 	int              ask_password;
 	int              dial_timeout;
+	int              dial_timeout_ms;
+	int              prompt_timeout_ms;
+	int              low_latency;
+	int              fast_redial;
+	int              event_fd;
+	int              sample_interval;
+	int              write_secrets;
        
     } options;
    
@@ -158,13 +222,23 @@ private:
     bool		chat_mode;
    
     bool		been_online;
-    time_t	connected_at;
-    time_t	auto_reconnect_delay;
-    time_t	auto_reconnect_at;
+    WvDialMsec	connected_at;
+    time_t	auto_reconnect_delay;	// seconds
+    WvDialMsec	auto_reconnect_at;
     WvPipe       *ppp_pipe;
    
     int     	phnum_count;
     int     	phnum_max;  
+    int		phnum_order[5];		// phnum_count -> Phone, Phone1..4
+    int		race_offset;
+   
+    WvDialNumberStats number_stats;
+    WvString	dialing;		// number of the current attempt
+    WvDialMsec	dial_sent_at;
+    WvString *	phone( int which );
+    void	order_numbers();
+    bool	next_number();
+    void	record_attempt( int result );
    
     WvLog	log;
     WvLog	err;
@@ -172,29 +246,83 @@ private:
    
     Status	stat;
    
-    time_t	last_rx;
-    time_t	last_execute;
+    // Deadlines registered with the event loop; see schedule_state().
+    enum Timer {
+	StateTimer,		// next time the current state needs execute()
+	SampleTimer		// next link sample, while Online
+    };
+    WvDialTimers timers;
+    void	schedule_state();
+   
+    WvDialSampler	sampler;
+    void	sample_link( WvDialMsec now );
+   
+    WvDialCapture	capture;
+   
+    WvDialControl	control;
+    void	run_command( WvDialControl::Command c );
+   
+    WvDialTimeline	session;
+    WvDialPhaseStats	session_stats;
+    void	end_session();
+   
+    WvDialMsec	last_rx;
     int		prompt_tries;
     WvString	prompt_response;
    
     void		load_options();
    
+    // modem setup that the last full init_modem() was done with
+    WvString	init_fingerprint;
+    WvString	modem_fingerprint() const;
+    bool	can_quick_init() const;
+    bool	quick_init();
+    bool	load_modem_options();
+    WvString *	init_string( int which );
+   
+    // init_modem(), a step per execute(), for the Init state.
+    enum InitStep {
+	InitOpen,		// open the modem
+	InitCheck,		// "Fast Redial": waiting for the OK to AT
+	InitWake,		// waiting for the modem to go quiet
+	InitWait,		// waiting for the answer to Init string init_num
+	InitQuiet		// waiting for the answer to ATQ0
+    };
+    bool	async_init;
+    InitStep	init_step;
+    int		init_try;
+    int		init_num;
+    bool	init_resent;
+    WvDialMsec	init_deadline;
+    void	start_init();
+    void	async_init_modem();
+    void	wake_modem();
+    void	send_init( int which );
+    void	init_failed( bool retry );
+   
     void		async_dial();
     void		async_waitprompt();
    
     void		start_ppp();
    
+    // Waiting, on whatever clock wvdial_msecs() is reading.
+    bool	modem_wait( time_t ms );
+    void	pause( time_t ms );
+   
     // The following members are for the wait_for_modem() function.
-    int		wait_for_modem( const char *strs[], int timeout, bool neednewline,
-				bool verbose = true);
-    int		async_wait_for_modem( const char * strs[], bool neednewline,
-				      bool verbose = true);
-    char	        buffer[ INBUF_SIZE + 1 ];
-    off_t	offset;
+    int		wait_for_modem( const WvDialMatcher &responses, int timeout,
+				bool neednewline, bool verbose = true);
+    int		async_wait_for_modem( const WvDialMatcher &responses, 
+				      bool neednewline, bool verbose = true);
+    WvDialRxBuf	rxbuf;
+    char	rxline[ INBUF_SIZE ];	// modem input not logged yet
+    size_t	rxline_len;
+    void	log_modem( const char * data, size_t len );
+    void	flush_modem_log();
     void	        reset_offset();
    
     // Called from WvDialBrain::guess_menu()
-    bool 	is_pending() { return( modem->select( 1000 ) ); }
+    bool 	is_pending() { return( modem_wait( 1000 ) ); }
    
     // These are used to read the messages of pppd
     int          pppd_msgfd[2];		// two fd of the pipe
@@ -0,0 +1,117 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Typed events for what pppd tells us.  See wvdialevent.h.
+ *
+ */
+
+#include "wvdialevent.h"
+
+#include <string.h>
+#include <stdio.h>
+
+const char * WvDialEvent::type_names[ NUM_TYPES ] = {
+    "pap_start",
+    "pap_success",
+    "pap_failure",
+    "chap_start",
+    "chap_success",
+    "chap_failure",
+    "local_ip",
+    "remote_ip",
+    "primary_dns",
+    "secondary_dns",
+    "ip_up",
+    "term_req",
+    "connect_time",
+    "interface",
+    "pppd_exit",
+    "dns_check",
+};
+
+
+void WvDialEvent::set( Type _type, const char *_text, size_t len, int _status )
+/****************************************************************************/
+{
+    type   = _type;
+    when   = wvdial_msecs();
+    status = _status;
+
+    if( len >= TEXT_SIZE )
+	len = TEXT_SIZE - 1;
+    if( _text )
+	memcpy( text, _text, len );
+    else
+	len = 0;
+    text[ len ] = '\0';
+}
+
+WvString WvDialEvent::json() const
+/********************************/
+{
+    // the text comes from the peer, so it gets escaped.
+    char	esc[ TEXT_SIZE * 6 + 1 ];
+    char *	e = esc;
+
+    for( const unsigned char *p = (const unsigned char *)text; *p; p++ )
+    {
+	if( *p == '"' || *p == '\\' )
+	{
+	    *e++ = '\\';
+	    *e++ = *p;
+	}
+	else if( *p < 0x20 || *p >= 0x7f )
+	    e += sprintf( e, "\\u%04x", *p );
+	else
+	    *e++ = *p;
+    }
+    *e = '\0';
+
+    WvString s( "{\"event\":\"%s\",\"ms\":%s", type_names[ type ], when );
+    if( type == IpUp || type == PppdExit || type == DnsCheck )
+	s.append( ",\"status\":%s", status );
+    if( text[0] )
+	s.append( ",\"text\":\"%s\"", esc );
+    s.append( "}" );
+    return( s );
+}
+
+
+WvDialEventRing::WvDialEventRing()
+/********************************/
+: head( 0 ), tail( 0 ), lost( 0 )
+{
+}
+
+bool WvDialEventRing::push( const WvDialEvent &ev )
+/*************************************************/
+{
+    unsigned t = tail;
+
+    if( t - head == SIZE )
+    {
+	lost++;
+	return( false );
+    }
+
+    ring[ t & ( SIZE - 1 ) ] = ev;
+    __sync_synchronize();	// the event is in place before tail moves
+    tail = t + 1;
+    return( true );
+}
+
+bool WvDialEventRing::pop( WvDialEvent &ev )
+/******************************************/
+{
+    unsigned h = head;
+
+    if( h == tail )
+	return( false );
+
+    __sync_synchronize();	// don't read the slot before seeing tail
+    ev = ring[ h & ( SIZE - 1 ) ];
+    __sync_synchronize();	// done with the slot before head moves
+    head = h + 1;
+    return( true );
+}
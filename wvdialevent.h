@@ -0,0 +1,85 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Typed events for what pppd tells us, so frontends don't have to scrape
+ * the log.
+ *
+ */
+
+#ifndef __WVDIALEVENT_H
+#define __WVDIALEVENT_H
+
+#include <stddef.h>
+
+#include "wvstring.h"
+#include "wvdialtimer.h"
+
+struct WvDialEvent
+/****************/
+{
+    enum Type {
+	PapStart,
+	PapSuccess,
+	PapFailure,		// text: the peer's message, if any
+	ChapStart,
+	ChapSuccess,
+	ChapFailure,		// text: the peer's message, if any
+	LocalIP,		// text: the address
+	RemoteIP,
+	PrimaryDNS,
+	SecondaryDNS,
+	IpUp,			// status: ip-up's exit status
+	TermReq,		// text: the peer's reason, if any
+	ConnectTime,		// text: e.g. "12.3 minutes."
+	Interface,		// text: e.g. "ppp0"
+	PppdExit,		// status: pppd's exit code
+	DnsCheck,		// status: 1 if DNS works; text: why not
+	NUM_TYPES
+    };
+    static const char *	type_names[ NUM_TYPES ];
+
+    enum { TEXT_SIZE = 64 };
+
+    Type	type;
+    WvDialMsec	when;
+    int		status;
+    char	text[ TEXT_SIZE ];	// always NUL-terminated
+
+    void	set( Type _type, const char *_text = NULL, size_t len = 0,
+		     int _status = 0 );
+
+    // e.g. {"event":"local_ip","ms":12345,"text":"10.1.2.3"}
+    // with no trailing newline.  "ms" is wvdial_msecs() time.
+    WvString	json() const;
+};
+
+
+class WvDialEventRing
+/*******************/
+// A fixed ring with one producer (WvDialMon, or whoever feeds it lines)
+// and one consumer, which need no lock between them: each side only writes
+// its own index, after a memory barrier.  When the consumer falls behind,
+// new events are dropped and counted rather than blocking the producer.
+{
+public:
+    enum { SIZE = 64 };		// must be a power of two
+
+    WvDialEventRing();
+
+    bool	push( const WvDialEvent &ev );
+    bool	pop( WvDialEvent &ev );
+
+    bool	isempty() const
+        { return( head == tail ); }
+    unsigned long dropped() const
+        { return( lost ); }
+
+private:
+    WvDialEvent		ring[ SIZE ];
+    volatile unsigned	head;		// next to pop; only pop() writes it
+    volatile unsigned	tail;		// next to push; only push() writes it
+    volatile unsigned long lost;
+};
+
+#endif // __WVDIALEVENT_H
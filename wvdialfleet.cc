@@ -0,0 +1,206 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Run a whole bank of modems from a single process.  See wvdialfleet.h.
+ *
+ */
+
+#include "wvdialfleet.h"
+
+#include <string.h>
+
+// restart delays double from MIN_BACKOFF up to MAX_BACKOFF
+#define MIN_BACKOFF	5000
+#define MAX_BACKOFF	300000
+
+
+static bool is_member_section( WvStringParm name )
+/************************************************/
+{
+    return( !strncmp( name, "Dialer ", 7 ) && name != "Dialer Defaults" );
+}
+
+WvDialFleet::WvDialFleet( WvConf &_cfg, WvStringList &sections )
+/**************************************************************/
+: cfg( _cfg ), log( "WvDial Fleet", WvLog::Notice ), 
+  members( NULL ), num_members( 0 )
+{
+    WvStringList names;
+    WvString	 cmdline;
+
+    WvStringList::Iter i( sections );
+    for( i.rewind(); i.next(); )
+    {
+	if( *i == "Command-Line" )
+	    cmdline = *i;
+	else if( is_member_section( *i ) )
+	    names.append( new WvString( *i ), true );
+    }
+
+    if( names.isempty() )
+    {
+	WvConfigSectionList::Iter sect( cfg );
+	for( sect.rewind(); sect.next(); )
+	    if( is_member_section( sect->name ) )
+		names.append( new WvString( sect->name ), true );
+    }
+
+    members = new Member[ names.count() ];
+
+    WvStringList::Iter n( names );
+    for( n.rewind(); n.next(); )
+	add_member( members[ num_members++ ], *n, cmdline );
+}
+
+WvDialFleet::~WvDialFleet()
+/*************************/
+{
+    for( int i = 0; i < num_members; i++ )
+	stop( members[i], false );
+    delete[] members;
+}
+
+void WvDialFleet::add_member( Member &m, WvStringParm sect, 
+			      WvStringParm cmdline )
+/*********************************************************/
+{
+    m.name = sect;
+    if( !!cmdline )
+	m.sections.append( new WvString( cmdline ), true );
+    m.sections.append( new WvString( sect ), true );
+    WvDialer::separate_files( cfg, m.sections, sect );
+    m.dialer     = NULL;
+    m.restart_at = 0;
+    m.failures   = 0;
+    m.was_online = false;
+}
+
+void WvDialFleet::start( Member &m )
+/**********************************/
+{
+    log( "[%s] starting.\n", m.name );
+
+    // the modem is initialised from the event loop, so one that doesn't
+    // answer holds up nobody else.
+    m.dialer     = new WvDialer( cfg, &m.sections, false, true );
+    m.was_online = false;
+
+    if( m.dialer->isok() && m.dialer->dial() )
+	list.append( m.dialer, false, m.name );
+    else
+	stop( m );
+}
+
+void WvDialFleet::stop( Member &m, bool restart )
+/***********************************************/
+// Take down m's dialer and, if 'restart', decide when to try again.
+{
+    if( !m.dialer )
+	return;
+
+    list.unlink( m.dialer );
+    m.dialer->hangup();
+    WVRELEASE( m.dialer );
+
+    if( !restart )
+	return;
+
+    if( m.was_online )
+	m.failures = 0;
+    else
+	m.failures++;
+
+    long delay = MIN_BACKOFF;
+    for( int i = 1; i < m.failures && delay < MAX_BACKOFF; i++ )
+	delay *= 2;
+    if( delay > MAX_BACKOFF )
+	delay = MAX_BACKOFF;
+
+    m.restart_at = wvdial_msecs() + delay;
+    log( "[%s] stopped; restarting in %s seconds.\n", m.name, delay / 1000 );
+}
+
+void WvDialFleet::check( Member &m, WvDialMsec now )
+/**************************************************/
+{
+    if( !m.dialer )
+    {
+	if( now >= m.restart_at )
+	    start( m );
+	return;
+    }
+
+    if( !m.dialer->isok() || m.dialer->status() == WvDialer::Idle )
+	stop( m );
+    else if( m.dialer->status() == WvDialer::Online && !m.was_online )
+    {
+	log( "[%s] online.\n", m.name );
+	m.was_online = true;
+    }
+}
+
+WvString WvDialFleet::summary() const
+/***********************************/
+{
+    int online = 0, dialing = 0, restarting = 0;
+
+    for( int i = 0; i < num_members; i++ )
+    {
+	if( !members[i].dialer )
+	    restarting++;
+	else if( members[i].dialer->status() == WvDialer::Online )
+	    online++;
+	else
+	    dialing++;
+    }
+    return( WvString( "%s online, %s dialing, %s restarting",
+		      online, dialing, restarting ) );
+}
+
+int WvDialFleet::run( volatile bool &stopping )
+/*********************************************/
+{
+    if( !num_members )
+    {
+	log( WvLog::Error, "No [Dialer] sections to run.\n" );
+	return( 1 );
+    }
+
+    log( "Supervising %s dialers.\n", num_members );
+
+    while( !stopping )
+    {
+	WvDialMsec now  = wvdial_msecs();
+	int	   wait = -1;
+
+	for( int i = 0; i < num_members; i++ )
+	{
+	    Member &m = members[i];
+
+	    check( m, now );
+	    if( !m.dialer )
+	    {
+		long left = (long)( m.restart_at - now );
+		if( wait < 0 || left < wait )
+		    wait = left > 0 ? left : 0;
+	    }
+	}
+
+	WvString s = summary();
+	if( s != last_summary )
+	{
+	    log( "%s.\n", s );
+	    last_summary = s;
+	}
+
+	// the dialers' own deadlines come in through their pre_select().
+	list.select( wait );
+	list.callback();
+    }
+
+    log( "Shutting down.\n" );
+    for( int i = 0; i < num_members; i++ )
+	stop( members[i], false );
+    return( 0 );
+}
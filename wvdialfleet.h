@@ -0,0 +1,63 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Run a whole bank of modems, one WvDialer per [Dialer X] section, from a
+ * single process.
+ *
+ */
+
+#ifndef __WVDIALFLEET_H
+#define __WVDIALFLEET_H
+
+#include "wvdialer.h"
+#include "wvistreamlist.h"
+#include "wvstringlist.h"
+
+class WvDialFleet
+/***************/
+// Each member dials on its own and is restarted, with a growing delay,
+// whenever its WvDialer gives up.  Config and logging are shared.
+{
+public:
+    // 'sections' is the usual list from the command line.  Every
+    // "Dialer X" in it becomes a member; if there are none, every
+    // [Dialer X] section in the config file does.
+    WvDialFleet( WvConf &_cfg, WvStringList &sections );
+    ~WvDialFleet();
+
+    int		count() const
+        { return( num_members ); }
+
+    // Runs until 'stop' is set.  Returns the exit code for wvdial.
+    int		run( volatile bool &stop );
+
+    // e.g. "3 online, 1 dialing, 1 restarting"
+    WvString	summary() const;
+
+private:
+    struct Member
+    {
+	WvString	name;
+	WvStringList	sections;
+	WvDialer *	dialer;
+	WvDialMsec	restart_at;
+	int		failures;	// in a row, without getting online
+	bool		was_online;
+    };
+
+    WvConf &		cfg;
+    WvLog		log;
+    WvIStreamList	list;
+    Member *		members;
+    int			num_members;
+    WvString		last_summary;
+
+    void	add_member( Member &m, WvStringParm sect, 
+			    WvStringParm cmdline );
+    void	start( Member &m );
+    void	stop( Member &m, bool restart = true );
+    void	check( Member &m, WvDialMsec now );
+};
+
+#endif // __WVDIALFLEET_H
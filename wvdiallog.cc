@@ -0,0 +1,170 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Queued, rate-limited logging.  See wvdiallog.h.
+ *
+ */
+
+#include "wvdiallog.h"
+#include "wvlog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+WvDialLogQueue *WvDialLogQueue::all_queues = NULL;
+
+
+WvDialLogQueue::WvDialLogQueue( WvDialLogSink &_sink )
+/****************************************************/
+: sink( _sink ), num_sources( 0 ), head( 0 ), count( 0 ), 
+  flushing( false ), total_dropped( 0 )
+{
+    next_queue = all_queues;
+    all_queues = this;
+}
+
+WvDialLogQueue::~WvDialLogQueue()
+/*******************************/
+{
+    flush();
+
+    WvDialLogQueue **q;
+    for( q = &all_queues; *q && *q != this; q = &(*q)->next_queue )
+	;
+    if( *q )
+	*q = next_queue;
+}
+
+void WvDialLogQueue::flush_all()
+/******************************/
+{
+    for( WvDialLogQueue *q = all_queues; q; q = q->next_queue )
+	q->flush();
+}
+
+int WvDialLogQueue::find_source( const char *source )
+/***************************************************/
+// Sources are few and almost always the same pointer-equal strings, so a
+// linear search is plenty.  If there are too many, the last one stands in
+// for the rest.
+{
+    int i;
+    for( i = 0; i < num_sources; i++ )
+    {
+	if( !strncmp( sources[i].name, source, SOURCE_SIZE - 1 ) )
+	    return( i );
+    }
+    if( num_sources == MAX_SOURCES )
+	return( MAX_SOURCES - 1 );
+
+    Source &s = sources[ num_sources ];
+    strncpy( s.name, source, SOURCE_SIZE - 1 );
+    s.name[ SOURCE_SIZE - 1 ] = '\0';
+    s.per_sec = 0;
+    s.burst   = s.tokens = 0;
+    s.last    = 0;
+    s.dropped = 0;
+    return( num_sources++ );
+}
+
+void WvDialLogQueue::limit( const char *source, int per_sec, int burst )
+/**********************************************************************/
+{
+    Source &s = sources[ find_source( source ) ];
+    s.per_sec = per_sec;
+    s.burst   = s.tokens = ( burst > 0 ? burst : 1 ) * 1000LL;
+    s.last    = wvdial_msecs();
+}
+
+bool WvDialLogQueue::allow( Source &s )
+/*************************************/
+// A token bucket: per_sec records' worth of tokens trickle in every
+// second, up to the burst size, and each record takes one.
+{
+    if( s.per_sec <= 0 )
+	return( true );
+
+    WvDialMsec now = wvdial_msecs();
+    s.tokens += ( now - s.last ) * s.per_sec;
+    s.last    = now;
+    if( s.tokens > s.burst )
+	s.tokens = s.burst;
+
+    if( s.tokens < 1000 )
+	return( false );
+    s.tokens -= 1000;
+    return( true );
+}
+
+void WvDialLogQueue::add( const char *source, int level, const char *buf,
+			  size_t len )
+/***********************************************************************/
+{
+    int	    which = find_source( source );
+    Source &s     = sources[ which ];
+    time_t  now   = time( NULL );
+
+    if( level > WvLog::Notice && !allow( s ) )
+    {
+	s.dropped++;
+	total_dropped++;
+	return;
+    }
+
+    // the receiver itself is logging something; don't go round in circles.
+    if( flushing )
+    {
+	sink.deliver( source, level, now, buf, len );
+	return;
+    }
+
+    while( len > 0 )
+    {
+	if( count == SLOTS )
+	    flush();
+
+	Slot &slot  = ring[ ( head + count++ ) % SLOTS ];
+	size_t part = len < SLOT_SIZE ? len : SLOT_SIZE;
+	slot.source = which;
+	slot.level  = level;
+	slot.len    = part;
+	slot.when   = now;
+	memcpy( slot.buf, buf, part );
+	buf += part;
+	len -= part;
+    }
+}
+
+void WvDialLogQueue::flush()
+/**************************/
+{
+    if( flushing )
+	return;
+    flushing = true;
+
+    for( ; count > 0; count-- )
+    {
+	const Slot &slot = ring[ head ];
+	head = ( head + 1 ) % SLOTS;
+	sink.deliver( sources[ slot.source ].name, slot.level, slot.when,
+		      slot.buf, slot.len );
+    }
+    head = 0;
+
+    for( int i = 0; i < num_sources; i++ )
+    {
+	if( !sources[i].dropped )
+	    continue;
+
+	char msg[ 80 ];
+	int  len = snprintf( msg, sizeof( msg ),
+			     "(%lu log messages from %s dropped)\n",
+			     sources[i].dropped, sources[i].name );
+	sink.deliver( "WvDial", WvLog::Warning, time( NULL ), msg,
+		      len < (int)sizeof( msg ) ? len : sizeof( msg ) - 1 );
+	sources[i].dropped = 0;
+    }
+
+    flushing = false;
+}
@@ -0,0 +1,104 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A queue in front of a log receiver, so that logging never holds up the
+ * dialer: records are copied into a preallocated ring and written out in
+ * batches when the dialer has nothing better to do.
+ *
+ */
+
+#ifndef __WVDIALLOG_H
+#define __WVDIALLOG_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "wvdialtimer.h"
+
+class WvDialLogSink
+/*****************/
+// Where a WvDialLogQueue finally sends its records; usually the
+// receiver's own WvLogRcv::log().  'when' is when the record was logged,
+// not when it is delivered.
+{
+public:
+    virtual ~WvDialLogSink() { }
+    virtual void deliver( const char *source, int level, time_t when,
+			  const char *buf, size_t len ) = 0;
+};
+
+
+class WvDialLogQueue
+/******************/
+// Records longer than a slot take several, which the receiver sees as
+// several writes of one line, just as if the WvLog had been written to
+// piecewise.  When the ring is full it is flushed on the spot.  Receivers
+// should drop records below their level before add(), so those don't take
+// up slots or use up a rate limit.
+//
+// A source can be given a rate limit, in records per second with a burst
+// allowance.  Records over the limit are dropped, except for Notice and
+// more important ones, and the receiver is told how many went missing at
+// the next flush.
+{
+public:
+    enum {
+	SLOTS	    = 256,
+	SLOT_SIZE   = 120,
+	MAX_SOURCES = 16,
+	SOURCE_SIZE = 32
+    };
+
+    WvDialLogQueue( WvDialLogSink &_sink );
+    ~WvDialLogQueue();
+
+    void	add( const char *source, int level, const char *buf,
+		     size_t len );
+    void	flush();
+
+    // per_sec <= 0 removes the limit.
+    void	limit( const char *source, int per_sec, int burst );
+
+    unsigned long dropped() const
+        { return( total_dropped ); }
+
+    // Flush every queue there is; the dialer calls this before it sleeps.
+    static void	flush_all();
+
+private:
+    struct Source
+    {
+	char		name[ SOURCE_SIZE ];
+	int		per_sec;
+	long long	burst;		// in thousandths of a record
+	long long	tokens;		// likewise
+	WvDialMsec	last;
+	unsigned long	dropped;	// since the last report
+    };
+
+    struct Slot
+    {
+	short		source;
+	short		level;
+	unsigned short	len;
+	time_t		when;
+	char		buf[ SLOT_SIZE ];
+    };
+
+    WvDialLogSink &	sink;
+    Source		sources[ MAX_SOURCES ];
+    int			num_sources;
+    Slot		ring[ SLOTS ];
+    int			head, count;
+    bool		flushing;
+    unsigned long	total_dropped;
+
+    WvDialLogQueue *	next_queue;
+    static WvDialLogQueue *all_queues;
+
+    int		find_source( const char *source );
+    bool	allow( Source &s );
+};
+
+#endif // __WVDIALLOG_H
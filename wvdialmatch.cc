@@ -0,0 +1,99 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Aho-Corasick compiler for modem result string tables.
+ *
+ */
+
+#include "wvdialmatch.h"
+
+#include <string.h>
+#include <assert.h>
+
+WvDialMatcher::WvDialMatcher( const char * _strs[] )
+/**************************************************/
+: strs( _strs )
+{
+    int		max_states = 1;
+    int		i;
+
+    for( i = 0; strs[i] != NULL; i++ )
+	max_states += strlen( strs[i] );
+
+    // Build the trie.  Missing edges are -1 for now.
+    delta = new short[ max_states * 128 ];
+    out   = new short[ max_states ];
+    memset( delta, 0xff, max_states * 128 * sizeof( short ) );
+    for( i = 0; i < max_states; i++ )
+	out[i] = -1;
+    num_states = 1;
+
+    for( i = 0; strs[i] != NULL; i++ ) 
+    {
+	int state = START;
+
+	for( const char * c = strs[i]; *c; c++ ) 
+	{
+	    unsigned char ch = *c & 0x7f;
+	    if( delta[ state*128 + ch ] < 0 )
+		delta[ state*128 + ch ] = num_states++;
+	    state = delta[ state*128 + ch ];
+	}
+	if( out[ state ] < 0 )
+	    out[ state ] = i;
+    }
+
+    // Breadth-first, turn the trie into a complete DFA: every missing edge
+    // goes wherever the failure link (the longest proper suffix that is
+    // also in the trie) would have sent us.
+    short *	fail  = new short[ num_states ];
+    short *	queue = new short[ num_states ];
+    int		qhead = 0, qtail = 0;
+
+    for( int c = 0; c < 128; c++ ) 
+    {
+	short next = delta[ START*128 + c ];
+	if( next < 0 )
+	    delta[ START*128 + c ] = START;
+	else 
+	{
+	    fail[ next ] = START;
+	    queue[ qtail++ ] = next;
+	}
+    }
+
+    while( qhead < qtail ) 
+    {
+	int state = queue[ qhead++ ];
+
+	// inherit the output of our suffix, unless ours comes first.
+	int inherited = out[ fail[ state ] ];
+	if( inherited >= 0 && ( out[ state ] < 0 || inherited < out[ state ] ) )
+	    out[ state ] = inherited;
+
+	for( int c = 0; c < 128; c++ ) 
+	{
+	    short next = delta[ state*128 + c ];
+	    if( next < 0 )
+		delta[ state*128 + c ] = delta[ fail[ state ]*128 + c ];
+	    else 
+	    {
+		fail[ next ] = delta[ fail[ state ]*128 + c ];
+		queue[ qtail++ ] = next;
+	    }
+	}
+    }
+
+    assert( qtail == num_states - 1 );
+    delete[] fail;
+    delete[] queue;
+}
+
+
+WvDialMatcher::~WvDialMatcher()
+/*****************************/
+{
+    delete[] delta;
+    delete[] out;
+}
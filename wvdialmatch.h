@@ -0,0 +1,51 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Multi-pattern matcher for modem result strings.
+ *
+ */
+
+#ifndef __WVDIALMATCH_H
+#define __WVDIALMATCH_H
+
+class WvDialMatcher
+/*****************/
+// A NULL-terminated table of response strings (like "connect", "busy",
+// ...) compiled once into an Aho-Corasick automaton.  Feeding it one byte
+// at a time with step() finds every string in a single pass, and the state
+// can be kept between reads, so scanning costs only the new bytes.
+//
+// The strings should be lowercase ASCII; bytes with the high bit set never
+// match anything.
+{
+public:
+    WvDialMatcher( const char * strs[] );
+    ~WvDialMatcher();
+
+    // the state before any input has been seen.
+    enum { START = 0 };
+
+    int		step( int state, unsigned char c ) const
+        { return( c < 128 ? delta[ state*128 + c ] : START ); }
+
+    // The index into the table of the string that ends at 'state', or -1.
+    // If several do, the one listed first wins.
+    int		output( int state ) const
+        { return( out[ state ] ); }
+
+    const char * const * table() const
+        { return( strs ); }
+
+private:
+    const char **	strs;
+    short *		delta;		// full transition table, 128 per state
+    short *		out;
+    int			num_states;
+
+    // not copyable.
+    WvDialMatcher( const WvDialMatcher & );
+    WvDialMatcher &operator=( const WvDialMatcher & );
+};
+
+#endif // __WVDIALMATCH_H
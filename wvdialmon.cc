@@ -8,13 +8,12 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
-#include <regex.h>
-#include <netdb.h>
-#include <net/route.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 
 #include "wvdialmon.h"
 
@@ -31,14 +30,12 @@ WvDialMon::WvDialMon()
     // usleep_time = 1000;
     do_check_dfr = 0;
     do_check_dns = 0;
+    dnstimeout = 10;
     
-    route_fd = (FILE *) 0;
+    event_fd = -1;
     
     buffer.setsize(100);
     
-    regcomp( &rx_status, "status *= *", REG_EXTENDED );
-    regcomp( &rx_quote, "\\\"[^\\\"]+\\\"", REG_EXTENDED );
-    regcomp( &rx_namesrv, "nameserver *[0-9]+.[0-9]+.[0-9]+.[0-9]+", REG_EXTENDED );
     
     reset();
 }
@@ -47,9 +44,6 @@ WvDialMon::WvDialMon()
 
 WvDialMon::~WvDialMon()
 {
-    regfree( &rx_status );
-    regfree( &rx_quote );
-    regfree( &rx_namesrv );
 }
 
 
@@ -63,6 +57,10 @@ void WvDialMon::setdnstests (WvString dnstest1, WvString dnstest2)
 void WvDialMon::reset()
 {
     _auth_failed = 0;
+    _ip_up = 0;
+    iface[0] = '\0';
+    remote_ip = 0;
+    dns.cancel();
 }
 
 const int WvDialMon::auth_failed()
@@ -71,437 +69,390 @@ const int WvDialMon::auth_failed()
 }
 
 
-int WvDialMon::get_quotedtext(char *dest, const char *line)
+static const char *find_quoted( const char *line, size_t *len )
+/***************************************************************/
+// Finds the first non-empty "quoted" text in line, quotes included.
 {
-    regmatch_t rm[1];
-    
-    if( regexec( &rx_quote, line, 1, &rm[0], 0 ) == REG_NOMATCH ) 
+    const char *p = strchr( line, '"' );
+    while( p )
     {
-	err("***** no quoted text found in `%s' *****\n", line );
-	return 0;
+	const char *e = strchr( p + 1, '"' );
+	if( !e )
+	    break;
+	if( e > p + 1 )
+	{
+	    *len = e - p + 1;
+	    return( p );
+	}
+	p = e;
     }
-    
-    int s = rm[0].rm_so, e = rm[0].rm_eo;
-    strncpy (dest, &line[s], e-s);
-    dest[e-s] = '\0';
-    
-    return 1;
+    return( NULL );
 }
 
-char *WvDialMon::analyse_line(const char *line)
-{
-    regmatch_t rm[1];
-    
-    if (line == NULL )
-        return NULL;
 
-    // PAP stuff
-    // 
-    if (strstr(line, "AuthReq") != NULL)
-	log("Authentication (PAP) started\n");
-    
-    if (strstr(line, "AuthAck") != NULL)
-	log("Authentication (PAP) successful\n");
-    
-    if (strstr(line, "AuthNak") != NULL) {
-	log("Authentication (PAP) failed");
-	
-	char buf[strlen(line)];
-	if( get_quotedtext( buf, line ) )
-	    log(" (Message: %s )\n", buf);
-	
-	_auth_failed = 1;
-    }
-    
-    
-    // CHAP stuff
-    // 
-    if (strstr(line, "CHAP Challenge") != NULL)
-	log("Authentication (CHAP) started\n");
-    
-    if (strstr(line, "CHAP Success") != NULL)
-	log("Authentication (CHAP) successful\n");
-    
-    if (strstr(line, "CHAP Failure") != NULL) {
-	log("Authentication (CHAP) failed");
-	
-	char buf[strlen(line)];
-	if( get_quotedtext( buf, line ) )
-	    log(" (Message: %s )\n", buf);
-	
-	_auth_failed = 1;
-    }
-    
-    
-    // IP stuff
-    // 
-    if (!strncmp(line, "local  IP address", 17)     ||
-	!strncmp(line, "remote IP address", 17)     ||
-	!strncmp(line, "primary   DNS address", 20) ||
-	!strncmp(line, "secondary DNS address", 20)   )
+void WvDialMon::set_event_fd( int fd )
+/************************************/
+// A slow reader loses events rather than holding up the dialer, and one
+// that goes away must not kill us with SIGPIPE.
+{
+    event_fd = fd;
+    if( fd >= 0 ) 
     {
-	log("%s\n",line);
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+	signal( SIGPIPE, SIG_IGN );
     }
-    
-    // Script stuff
-    // 
-    if (strncmp(line, "Script", 6) == 0) 
+}
+
+
+void WvDialMon::emit( WvDialEvent::Type type, const char *text, size_t len,
+		      int status )
+/*************************************************************************/
+{
+    WvDialEvent ev;
+    ev.set( type, text, len, status );
+    events.push( ev );
+
+    if( event_fd >= 0 ) 
     {
-	if (strstr(line, "/etc/ppp/ip-up") != NULL && strstr(line, "finished") != NULL) 
-	{    
-	    if( regexec( &rx_status, line, 1, &rm[0], 0 ) == 0 ) 
-	    {
-		const char *p = &line[ rm[0].rm_eo ];
-		
-		// err("***** status is `%s' *****\n", p2 );
-
-		if (strcmp( p, "0x0") == 0) 
-		{
-		    
-		    log("Script /etc/ppp/ip-up run successful\n");
-		    
-		    if( do_check_dfr ) 
-		    {
-			if( check_dfr() )
-			    log( "Default route Ok.\n" );
-			else
-			    log( "Default route failure.\n" );
-		    }
-		    
-		    if( do_check_dns ) 
-		    {
-			if( check_dns() )
-			    log( "Nameserver (DNS) Ok.\n" );
-			else
-			    log( "Nameserver (DNS) failure, the connection may not work.\n" );
-		    }
-		    
-		    log( "%s\n", connectmsg );
-		    
-		    //	  execute whatever the user wants to
-		    //
-		    //  	  if( executename.len() > 0 ) {
-		    //
-		    //  	    fflush(stdout);
-		    //  	    fflush(stderr);
-		    //
-		    //  	    pid_t pid = fork();
-		    //
-		    //  	    if( pid == (pid_t) 0 ) { // we are the child
-		    //
-		    //  	      int devnullr = open("/dev/null",O_RDONLY,0);
-		    //  	      dup2(devnullr, fileno(stdin));
-		    //  	      close(devnullr);
-		    //
-		    //  	      int devnullw = open("/dev/null",O_WRONLY,0);
-		    //  	      dup2(devnullw, fileno(stdout));
-		    //  	      dup2(devnullw, fileno(stderr));
-		    //  	      close(devnullw);
-		    //  	      fflush(stdout);
-		    //  	      fflush(stderr);
-		    //
-		    //  	      for( int tty = 3; tty < 256; tty++ )
-		    //  		close(tty);
-		    //
-		    //  	      usleep( usleep_time );
-		    //
-		    //  	      // executename = Netscape -remote "reload()", macht probleme
-		    //  	      // wenn mehrere netscapes auf dem xserver laufen (dann
-		    //  	      // empfngt zufllig einer die message)
-		    //
-		    //  	      const char *new_argv[4];
-		    //  	      new_argv[0] = "sh";
-		    //  	      new_argv[1] = "-c";
-		    //  	      new_argv[2] = executename;
-		    //  	      new_argv[3] = NULL;
-		    //
-		    //  	      execv( "/bin/sh", (char *const *) new_argv );
-		    //
-		    //  	      fprintf( stderr, "exec failed: %s\n", strerror(errno) );
-		    //  	    }
-		    //
-		    //	    if( pid < (pid_t) 0 ) // the fork failed
-		    //	      fprintf( stderr, "error: can't fork child process\n" );
-		    //	    else
-		    //	      output( "Started `", executename, "' successfully\n" );
-		    //
-		    //	  }
-		    
-		} 
-		else
-		{
-		    log("Script /etc/ppp/ip-up failed (return value: %s )\n", p);
-		}
-
-	    } 
-	    else 
-	    {
-		// fprintf( stderr, "***** no status found *****\n" );
-	    }
-	    
+	WvString json( "%s\n", ev.json() );
+	if( ::write( event_fd, json, json.len() ) < 0 && errno != EAGAIN ) 
+	{
+	    err( "Cannot write events: %s\n", strerror( errno ) );
+	    event_fd = -1;
 	}
-	
-	if (strstr(line, "/etc/ppp/ip-down") != NULL && strstr(line, "started") != NULL)
-	    log("Script /etc/ppp/ip-down started\n");
     }
-    
-    
-    // TermReq stuff
-    // 
-    if (strstr(line, "LCP TermReq") != NULL) 
-    {
-	log("Terminate Request");
+}
+
+
+void WvDialMon::log_message( const char *line, WvDialEvent::Type type )
+/*********************************************************************/
+// Finishes a log line with the quoted message from a pppd packet, if it
+// has one, and sends the event with the message (unquoted) in it.
+{
+    size_t	len;
+    const char *q = find_quoted( line, &len );
 
-	char buf[strlen(line)];
-	if( get_quotedtext( buf, line ) )
-	    log(" (Message: %s )\n", buf);
+    if( !q ) 
+    {
+	log( "\n" );
+	err( "***** no quoted text found in `%s' *****\n", line );
+	emit( type );
+	return;
     }
     
-    
-    // connect time stuff
-    // 
-    if (strncmp(line, "Connect time", 12) == 0)
-	log("%s\n",line);
-    
-    
-    // interface stuff
-    // 
-    if (strncmp(line, "Using interface", 15) == 0)
-	log("%s\n", line);
-    
-    // terminate stuff
-    // 
-    if( strncmp(line,"Terminating", 11 ) == 0 )
-	log("%s\n",line);
-    
-    
-    return buffer.edit();
+    log( " (Message: " );
+    log.write( q, len );
+    log( " )\n" );
+    emit( type, q + 1, len - 2 );
 }
 
 
+const char *WvDialMon::log_field( const char *line, size_t skip,
+				  WvDialEvent::Type type )
+/******************************************************************/
+// Logs the whole line, and sends the event with what follows the first
+// 'skip' characters.  Returns that field.
+{
+    log( "%s\n", line );
 
-/********* taken from pppd ************/
-
-#define KVERSION(j,n,p)	((j)*1000000 + (n)*1000 + (p))
-
-#define SET_SA_FAMILY(addr, family)			\
-	memset ((char *) &(addr), '\0', sizeof(addr));	\
-    addr.sa_family = (family);
+    const char *p = line + skip;
+    while( *p == ' ' )
+	p++;
+    emit( type, p, strlen( p ) );
+    return( p );
+}
 
-#define SIN_ADDR(x)	(((struct sockaddr_in *) (&(x)))->sin_addr.s_addr)
 
-#define ROUTE_MAX_COLS	12
+static bool starts( const char *line, const char *token, size_t len )
+/*******************************************************************/
+{
+    return( !strncmp( line, token, len ) );
+}
 
-/********************************************************************
- *
- * close_route_table - close the interface to the route table
- */
 
-void WvDialMon::close_route_table ()
+void WvDialMon::analyse_packet( const char *line, const char *pkt )
+/*****************************************************************/
+// pkt points just past "sent [" or "rcvd [", at e.g. "CHAP Success ...".
 {
-    if (route_fd != (FILE *) 0) 
+    switch( pkt[0] ) 
     {
-	fclose (route_fd);
-	route_fd = (FILE *) 0;
+    case 'P':	// PAP stuff
+	if( starts( pkt, "PAP AuthReq", 11 ) )
+	{
+	    log( "Authentication (PAP) started\n" );
+	    emit( WvDialEvent::PapStart );
+	}
+	else if( starts( pkt, "PAP AuthAck", 11 ) )
+	{
+	    log( "Authentication (PAP) successful\n" );
+	    emit( WvDialEvent::PapSuccess );
+	}
+	else if( starts( pkt, "PAP AuthNak", 11 ) ) 
+	{
+	    log( "Authentication (PAP) failed" );
+	    log_message( line, WvDialEvent::PapFailure );
+	    _auth_failed = 1;
+	}
+	break;
+	
+    case 'C':	// CHAP stuff
+	if( starts( pkt, "CHAP Challenge", 14 ) )
+	{
+	    log( "Authentication (CHAP) started\n" );
+	    emit( WvDialEvent::ChapStart );
+	}
+	else if( starts( pkt, "CHAP Success", 12 ) )
+	{
+	    log( "Authentication (CHAP) successful\n" );
+	    emit( WvDialEvent::ChapSuccess );
+	}
+	else if( starts( pkt, "CHAP Failure", 12 ) ) 
+	{
+	    log( "Authentication (CHAP) failed" );
+	    log_message( line, WvDialEvent::ChapFailure );
+	    _auth_failed = 1;
+	}
+	break;
+	
+    case 'L':	// TermReq stuff
+	if( starts( pkt, "LCP TermReq", 11 ) ) 
+	{
+	    log( "Terminate Request" );
+	    log_message( line, WvDialEvent::TermReq );
+	}
+	break;
     }
 }
 
-/********************************************************************
- *
- * open_route_table - open the interface to the route table
- */
 
-static char route_delims[] = " \t\n";
-
-int WvDialMon::open_route_table ()
+void WvDialMon::analyse_script( const char *line )
+/************************************************/
 {
-    char path[] = "/proc/net/route";
+    if( strstr( line, "/etc/ppp/ip-down" ) != NULL )
+    {
+	if( strstr( line, "started" ) != NULL )
+	    log( "Script /etc/ppp/ip-down started\n" );
+	return;
+    }
     
-    close_route_table();
+    if( strstr( line, "/etc/ppp/ip-up" ) == NULL 
+	|| strstr( line, "finished" ) == NULL )
+	return;
     
-    route_fd = fopen (path, "r");
-    if (route_fd == NULL) {
-	log( "can't read %s\n", path );
-	return 0;
+    // "Script /etc/ppp/ip-up finished (pid 1234), status = 0x0"
+    const char *p = strstr( line, "status" );
+    if( p == NULL ) 
+    {
+	// fprintf( stderr, "***** no status found *****\n" );
+	return;
     }
+    for( p += 6; *p == ' '; p++ )
+	;
+    if( *p++ != '=' )
+	return;
+    while( *p == ' ' )
+	p++;
     
-    route_dev_col = 0;		/* default to usual columns */
-    route_dest_col = 1;
-    route_gw_col = 2;
-    route_flags_col = 3;
-    route_mask_col = 7;
-    route_num_cols = 8;
-    
-    /* parse header line */
-    if (fgets(route_buffer, sizeof(route_buffer), route_fd) != 0) 
+    // err("***** status is `%s' *****\n", p2 );
+    emit( WvDialEvent::IpUp, p, strlen( p ), strtol( p, NULL, 0 ) );
+
+    if (strcmp( p, "0x0") == 0) 
     {
-	char *p = route_buffer, *q;
-	int col;
-	for (col = 0; col < ROUTE_MAX_COLS; ++col) 
+
+	log("Script /etc/ppp/ip-up run successful\n");
+	_ip_up = 1;
+
+	if( do_check_dfr ) 
 	{
-	    int used = 1;
-	    if ((q = strtok(p, route_delims)) == 0)
-		break;
-	    if (strcasecmp(q, "iface") == 0)
-		route_dev_col = col;
-	    else if (strcasecmp(q, "destination") == 0)
-		route_dest_col = col;
-	    else if (strcasecmp(q, "gateway") == 0)
-		route_gw_col = col;
-	    else if (strcasecmp(q, "flags") == 0)
-		route_flags_col = col;
-	    else if (strcasecmp(q, "mask") == 0)
-		route_mask_col = col;
+	    if( check_dfr() )
+		log( "Default route Ok.\n" );
 	    else
-		used = 0;
-	    if (used && col >= route_num_cols)
-		route_num_cols = col + 1;
-	    p = NULL;
+		log( "Default route failure.\n" );
 	}
-    }
-    
-    return 1;
-}
-
-/********************************************************************
- *
- * read_route_table - read the next entry from the route table
- */
 
-int WvDialMon::read_route_table(struct rtentry *rt)
-{
-    char *cols[ROUTE_MAX_COLS], *p;
-    int col;
-    
-    memset (rt, '\0', sizeof (struct rtentry));
-    
-    if (fgets (route_buffer, sizeof (route_buffer), route_fd) == (char *) 0)
-	return 0;
-    
-    p = route_buffer;
-    for (col = 0; col < route_num_cols; ++col) {
-	cols[col] = strtok(p, route_delims);
-	if (cols[col] == NULL)
-	    return 0;		/* didn't get enough columns */
-	p = NULL;
+	if( do_check_dns ) 
+	    start_dns_check();
+
+	log( "%s\n", connectmsg );
+
+	//	  execute whatever the user wants to
+	//
+	//  	  if( executename.len() > 0 ) {
+	//
+	//  	    fflush(stdout);
+	//  	    fflush(stderr);
+	//
+	//  	    pid_t pid = fork();
+	//
+	//  	    if( pid == (pid_t) 0 ) { // we are the child
+	//
+	//  	      int devnullr = open("/dev/null",O_RDONLY,0);
+	//  	      dup2(devnullr, fileno(stdin));
+	//  	      close(devnullr);
+	//
+	//  	      int devnullw = open("/dev/null",O_WRONLY,0);
+	//  	      dup2(devnullw, fileno(stdout));
+	//  	      dup2(devnullw, fileno(stderr));
+	//  	      close(devnullw);
+	//  	      fflush(stdout);
+	//  	      fflush(stderr);
+	//
+	//  	      for( int tty = 3; tty < 256; tty++ )
+	//  		close(tty);
+	//
+	//  	      usleep( usleep_time );
+	//
+	//  	      // executename = Netscape -remote "reload()", macht probleme
+	//  	      // wenn mehrere netscapes auf dem xserver laufen (dann
+	//  	      // empfngt zufllig einer die message)
+	//
+	//  	      const char *new_argv[4];
+	//  	      new_argv[0] = "sh";
+	//  	      new_argv[1] = "-c";
+	//  	      new_argv[2] = executename;
+	//  	      new_argv[3] = NULL;
+	//
+	//  	      execv( "/bin/sh", (char *const *) new_argv );
+	//
+	//  	      fprintf( stderr, "exec failed: %s\n", strerror(errno) );
+	//  	    }
+	//
+	//	    if( pid < (pid_t) 0 ) // the fork failed
+	//	      fprintf( stderr, "error: can't fork child process\n" );
+	//	    else
+	//	      output( "Started `", executename, "' successfully\n" );
+	//
+	//	  }
+
+    } 
+    else
+    {
+	log("Script /etc/ppp/ip-up failed (return value: %s )\n", p);
     }
-    
-    SET_SA_FAMILY (rt->rt_dst,     AF_INET);
-    SET_SA_FAMILY (rt->rt_gateway, AF_INET);
-    
-    SIN_ADDR(rt->rt_dst) = strtoul(cols[route_dest_col], NULL, 16);
-    SIN_ADDR(rt->rt_gateway) = strtoul(cols[route_gw_col], NULL, 16);
-    SIN_ADDR(rt->rt_genmask) = strtoul(cols[route_mask_col], NULL, 16);
-    
-    rt->rt_flags = (short) strtoul(cols[route_flags_col], NULL, 16);
-    rt->rt_dev   = cols[route_dev_col];
-    
-    return 1;
 }
 
-/********************************************************************
- *
- * defaultroute_exists - determine if there is a default route
- */
 
-int WvDialMon::defaultroute_exists (struct rtentry *rt)
+char *WvDialMon::analyse_line(const char *line)
+/*********************************************/
+// One pass: pppd's debug output is mostly packet dumps, so those are
+// recognised first and only their protocol and type looked at; anything
+// else is dispatched on its first character.
 {
-    int result = 0;
-    
-    if (!open_route_table())
-	return 0;
+    if (line == NULL )
+        return NULL;
+
+    if( ( line[0] == 's' && starts( line, "sent [", 6 ) )
+	|| ( line[0] == 'r' && starts( line, "rcvd [", 6 ) ) )
+    {
+	analyse_packet( line, line + 6 );
+	return buffer.edit();
+    }
     
-    while (read_route_table(rt) != 0) 
+    switch( line[0] ) 
     {
-	if ((rt->rt_flags & RTF_UP) == 0)
-	    continue;
+    case 'l':	// IP stuff
+	if( starts( line, "local  IP address", 17 ) )
+	    log_field( line, 17, WvDialEvent::LocalIP );
+	break;
+    case 'r':
+	if( starts( line, "remote IP address", 17 ) )
+	    remote_ip = inet_addr( log_field( line, 17, WvDialEvent::RemoteIP ) );
+	break;
+    case 'p':
+	if( starts( line, "primary   DNS address", 21 ) )
+	    log_field( line, 21, WvDialEvent::PrimaryDNS );
+	break;
+    case 's':
+	if( starts( line, "secondary DNS address", 21 ) )
+	    log_field( line, 21, WvDialEvent::SecondaryDNS );
+	break;
+	
+    case 'S':	// Script stuff
+	if( starts( line, "Script", 6 ) )
+	    analyse_script( line );
+	break;
+	
+    case 'C':	// connect time stuff
+	if( starts( line, "Connect time", 12 ) )
+	    log_field( line, 12, WvDialEvent::ConnectTime );
+	break;
 	
-	if (kernel_version > KVERSION(2,1,0) && SIN_ADDR(rt->rt_genmask) != 0)
-	    continue;
-	if (SIN_ADDR(rt->rt_dst) == 0L) 
+    case 'U':	// interface stuff
+	if( starts( line, "Using interface", 15 ) )
 	{
-	    result = 1;
-	    break;
+	    strncpy( iface, log_field( line, 15, WvDialEvent::Interface ),
+		     sizeof( iface ) - 1 );
+	    iface[ sizeof( iface ) - 1 ] = '\0';
 	}
+	break;
+	
+    case 'T':	// terminate stuff
+	if( starts( line, "Terminating", 11 ) )
+	    log( "%s\n", line );
+	break;
     }
     
-    close_route_table();
-    return result;
+    return buffer.edit();
 }
 
+
 int WvDialMon::check_dfr()
+/*************************/
+// The default route has to go out over our link: through the interface
+// pppd said it was using, and either straight out of it or via the peer.
 {
-    struct rtentry def_rt;
+    WvDialRoute rt;
     
-    if( !defaultroute_exists( &def_rt ) )
-	return 0;
-    
-    // FIXME: check if the gateway is set correct
-    // 
-    return 1;
-}
-
-int WvDialMon::check_dns_name( const char *name )
-{
-    struct hostent *hp;
-    hp = gethostbyname( name );
-    if( hp == NULL ) 
+    if( !routes.default_route( rt ) )
     {
-	log( "warning, can't find address for `%s`\n", name );
+	log( "No default route.\n" );
 	return 0;
     }
     
-    // err("***** official name for `%s' is `%s' *****\n", name, hp->h_name );
-    // 
-    return 1;
-}
-
-int WvDialMon::check_dns()
-{
-  char name[] = "/etc/resolv.conf";
-    
-    FILE *fin = fopen( name, "r" );
-    if( fin == NULL ) {
-	log( "warning, can't read `%s`\n", name );
-	return 0;
-    }
-    
-    const int size = 100;
-    char line[size];
-    
-    regmatch_t rm[1];
-    int found_namesrv = 0;
-    
-    while( fgets( line, size, fin ) != NULL ) 
+    if( iface[0] && rt.dev[0] && strcmp( iface, rt.dev ) )
     {
-	if( line[0] == '\n' || line[0] == '#' )
-	    continue;
-	
-	if( line[ strlen(line)-1 ] == '\n' )
-	    line[ strlen(line)-1 ] = '\0';
-	
-	if( regexec( &rx_namesrv, line, 1, &rm[0], 0 ) == 0 ) 
-	{
-	    found_namesrv = 1;
-	    break;
-	}
-	
-    }
-    
-    fclose( fin );
-    
-    if( !found_namesrv ) 
-    {
-	log( "warning, no nameserver found `%s`\n",name);
+	log( "Default route is through %s, not %s.\n", rt.dev, iface );
 	return 0;
     }
     
-    if (!check_dns_name ((const char* ) dnstest1) || !check_dns_name ((const char* ) dnstest2)) 
+    if( rt.gateway && remote_ip && remote_ip != INADDR_NONE
+	&& rt.gateway != remote_ip )
     {
-	log( "warning, address lookup does not work\n" );
+	struct in_addr gw;
+	gw.s_addr = rt.gateway;
+	log( "Default route is via %s, not our peer.\n", inet_ntoa( gw ) );
 	return 0;
     }
     
     return 1;
 }
 
+void WvDialMon::start_dns_check()
+/*******************************/
+// Just starts the lookups; poll_dns() reports how they went.
+{
+    if( !dns.start( dnsserver, dnstest1, dnstest2, dnstimeout * 1000 ) )
+	dns_done();
+}
+
+void WvDialMon::poll_dns()
+/************************/
+{
+    if( dns.running() && dns.poll() )
+	dns_done();
+}
+
+void WvDialMon::dns_done()
+/************************/
+{
+    WvString why = dns.result();
+
+    if( dns.ok() )
+	log( "Nameserver (DNS) Ok.\n" );
+    else
+    {
+	log( "warning, %s\n", why );
+	log( "Nameserver (DNS) failure, the connection may not work.\n" );
+    }
+    emit( WvDialEvent::DnsCheck, why, why.len(), dns.ok() );
+}
@@ -13,12 +13,14 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
-#include <regex.h>
 
 #include "wvbuf.h"
 #include "wvstring.h"
 #include "wvlog.h"
 #include "strutils.h"
+#include "wvdialevent.h"
+#include "wvdialdns.h"
+#include "wvdialroute.h"
 
 class WvDialMon
 {
@@ -33,8 +35,21 @@ public:
    
    void setdnstests (WvString, WvString);
    void setcheckdns (int flag) { do_check_dns = flag; }
+   void setdnsserver (WvStringParm server) { dnsserver = server; }
+   void setdnstimeout (int secs) { dnstimeout = secs; }
+   
+   // The DNS check runs in the background once ip-up has finished: put
+   // dns_fd() in the select() set, wake up after dns_msec_until(), and
+   // call poll_dns() after either.  The result comes as a DnsCheck event.
+   int dns_fd() const { return dns.getfd(); }
+   long dns_msec_until( WvDialMsec now ) const { return dns.msec_until( now ); }
+   void poll_dns();
    void setcheckdfr (int flag) { do_check_dfr = flag; }
    
+   // Read the routes from a file in /proc/net/route format instead of
+   // asking the kernel; "" goes back to the kernel.
+   void setroutefile (WvStringParm fname) { routes.use_file( fname ); }
+   
    void reset();
    
    // the returned buffer is only valid until the next call
@@ -42,6 +57,25 @@ public:
    
    const int auth_failed();
    
+   // the ppp interface pppd is using, or "" if it hasn't said yet
+   const char *interface() const { return iface; }
+   
+   // true once /etc/ppp/ip-up has finished successfully
+   const int ip_up() { return _ip_up; }
+   
+   // Typed versions of what analyse_line() logs, oldest first, for the
+   // control socket's "events" command.  Returns false if there are none
+   // waiting.
+   bool get_event( WvDialEvent &ev ) { return events.pop( ev ); }
+   unsigned long events_dropped() const { return events.dropped(); }
+   
+   // Also write every event to fd as a line of JSON; -1 turns that off.
+   void set_event_fd( int fd );
+   
+   // Report an event that analyse_line() can't see, eg. pppd exiting.
+   void emit( WvDialEvent::Type type, const char *text = NULL, 
+	      size_t len = 0, int status = 0 );
+   
 private:
    
    // name of program to execute after successful connection
@@ -53,49 +87,44 @@ private:
    // time to wait before launch of executename
    // int usleep_time;
    // 
-   // regex to match `status = '
-   regex_t rx_status;
-   
-   // regex to match quoted (not empty) text
-   regex_t rx_quote;
-   
-   
    WvLog log;
    WvLog err;
    
    WvString buffer;
    
-   int get_quotedtext(char *dest, const char *line);
+   // pieces of analyse_line()
+   void analyse_packet( const char *line, const char *pkt );
+   void analyse_script( const char *line );
+   void log_message( const char *line, WvDialEvent::Type type );
+   const char *log_field( const char *line, size_t skip,
+			  WvDialEvent::Type type );
+   
+   WvDialEventRing events;
+   int event_fd;
    
    // flag
    int _auth_failed;
+   int _ip_up;
    
    // check defaultroute stuff
    // 
    int do_check_dfr;
    int check_dfr();
    
-   int kernel_version;
-   FILE *route_fd;
-   char route_buffer[512];
-   int route_dev_col, route_dest_col, route_gw_col;
-   int route_flags_col, route_mask_col;
-   int route_num_cols;
-   
-   int open_route_table ();
-   void close_route_table ();
-   int read_route_table (struct rtentry *rt);
-   int defaultroute_exists (struct rtentry *rt);
+   WvDialRouteTable routes;
+   char iface[ IF_NAMESIZE ];	// from "Using interface"
+   in_addr_t remote_ip;		// from "remote IP address"
    
    // check DNS stuff
    // 
    int do_check_dns;
-   int check_dns();
+   void start_dns_check();
+   void dns_done();
    
    WvString dnstest1, dnstest2;
-   
-   int check_dns_name( const char *name );
-   regex_t rx_namesrv;
+   WvString dnsserver;
+   int dnstimeout;
+   WvDialDNSCheck dns;
    
 };
 
@@ -0,0 +1,101 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Single-pass normalisation of modem input, vectorised where the CPU
+ * allows.
+ *
+ */
+
+#include "wvdialnorm.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define WVDIAL_NEON 1
+#endif
+
+
+static inline unsigned char norm_byte( unsigned char c )
+/******************************************************/
+{
+    c &= 0x7f;
+    return( c ? c : ' ' );
+}
+
+
+static inline unsigned char lower_byte( unsigned char c )
+/*******************************************************/
+{
+    return( ( c >= 'A' && c <= 'Z' ) ? c | 0x20 : c );
+}
+
+
+void wvdial_normalise( const char * _src, char * _clean, char * _lower,
+		       size_t len )
+/***********************************************************************/
+{
+    const unsigned char * src   = (const unsigned char *)_src;
+    unsigned char *	  clean = (unsigned char *)_clean;
+    unsigned char *	  lower = (unsigned char *)_lower;
+    size_t		  i = 0;
+
+#if defined(__SSE2__)
+    const __m128i mask7f = _mm_set1_epi8( 0x7f );
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i bit20  = _mm_set1_epi8( 0x20 );
+    const __m128i below  = _mm_set1_epi8( 'A' - 1 );
+    const __m128i above  = _mm_set1_epi8( 'Z' + 1 );
+
+    for( ; i + 16 <= len; i += 16 ) 
+    {
+	__m128i c = _mm_and_si128(
+		_mm_loadu_si128( (const __m128i *)( src + i ) ), mask7f );
+
+	// NUL is the only byte that becomes zero; OR a space into it.
+	c = _mm_or_si128( c, _mm_and_si128( _mm_cmpeq_epi8( c, zero ), bit20 ) );
+	_mm_storeu_si128( (__m128i *)( clean + i ), c );
+
+	if( lower ) 
+	{
+	    // all bytes are 0..127 now, so signed compares are fine.
+	    __m128i upper = _mm_and_si128( _mm_cmpgt_epi8( c, below ),
+					   _mm_cmplt_epi8( c, above ) );
+	    c = _mm_or_si128( c, _mm_and_si128( upper, bit20 ) );
+	    _mm_storeu_si128( (__m128i *)( lower + i ), c );
+	}
+    }
+#elif defined(WVDIAL_NEON)
+    const uint8x16_t mask7f = vdupq_n_u8( 0x7f );
+    const uint8x16_t zero   = vdupq_n_u8( 0 );
+    const uint8x16_t bit20  = vdupq_n_u8( 0x20 );
+    const uint8x16_t big_a  = vdupq_n_u8( 'A' );
+    const uint8x16_t big_z  = vdupq_n_u8( 'Z' );
+
+    for( ; i + 16 <= len; i += 16 ) 
+    {
+	uint8x16_t c = vandq_u8( vld1q_u8( src + i ), mask7f );
+
+	c = vorrq_u8( c, vandq_u8( vceqq_u8( c, zero ), bit20 ) );
+	vst1q_u8( clean + i, c );
+
+	if( lower ) 
+	{
+	    uint8x16_t upper = vandq_u8( vcgeq_u8( c, big_a ),
+					 vcleq_u8( c, big_z ) );
+	    c = vorrq_u8( c, vandq_u8( upper, bit20 ) );
+	    vst1q_u8( lower + i, c );
+	}
+    }
+#endif
+
+    // whatever is left over (or everything, on other CPUs).
+    for( ; i < len; i++ ) 
+    {
+	unsigned char c = norm_byte( src[i] );
+	clean[i] = c;
+	if( lower )
+	    lower[i] = lower_byte( c );
+    }
+}
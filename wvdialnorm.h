@@ -0,0 +1,22 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Clean-up of raw modem input before anyone looks at it.
+ *
+ */
+
+#ifndef __WVDIALNORM_H
+#define __WVDIALNORM_H
+
+#include <stddef.h>
+
+// Normalise 'len' bytes of modem input in a single pass: clear the parity
+// bit (to allow 7e1 connections) and turn NULs into spaces, for easier
+// parsing.  The result is written to 'clean'; if 'lower' is not NULL, a
+// lowercased copy is written there as well.  Either output may be the same
+// buffer as 'src'.  Neither is NUL-terminated.
+void wvdial_normalise( const char * src, char * clean, char * lower,
+		       size_t len );
+
+#endif // __WVDIALNORM_H
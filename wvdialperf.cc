@@ -0,0 +1,408 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * End-to-end benchmark: runs the real wvdial over and over against a
+ * WvModemSim, with a fake pppd that reports ip-up straight away, and
+ * reports time-to-Online (p50/p99, from wvdial's own "Timeline Log"), and
+ * the CPU time and peak RSS of each wvdial process.  The scenarios are a
+ * plain CONNECT, BUSY and NO CARRIER before connecting on the second
+ * number, a terminal server menu, and a login/password exchange.
+ *
+ * With -w the results are written to a baseline file; with -b they are
+ * compared against one, and anything more than 10% worse is a regression
+ * (and the exit code is 1).  "make bench" does one or the other.
+ *
+ * With -V, wvdial runs with "Virtual Time": the redial pauses and
+ * timeouts cost nothing, so many more sessions fit in the same time.
+ * Its times-to-Online are then on wvdial's virtual clock, and are not
+ * comparable with a baseline taken without -V.
+ *
+ * wvdial runs with "Write Secrets = 0", so its user "wvbench" is never
+ * added to /etc/ppp/pap-secrets or chap-secrets, even when run as root.
+ *
+ * Usage: wvdialperf [-V] [-n sessions] [-b baseline | -w baseline] [wvdial]
+ */
+
+#include "wvmodemsim.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// how much worse than the baseline counts as a regression
+#define REGRESSION_PCT	10
+
+static bool virtual_time = false;
+
+static const char fake_pppd[] =
+    "#!/bin/sh\n"
+    "# stands in for pppd: says what pppd says once a link is up, and quits.\n"
+    "while [ $# -gt 0 ]; do [ \"$1\" = logfd ] && fd=$2; shift; done\n"
+    "eval \"exec 3>&$fd\"\n"
+    "printf 'Using interface ppp0\\n' >&3\n"
+    "printf 'local  IP address 10.0.0.2\\n' >&3\n"
+    "printf 'remote IP address 10.0.0.1\\n' >&3\n"
+    "printf 'Script /etc/ppp/ip-up finished (pid 1), status = 0x0\\n' >&3\n"
+    "sleep 0.1\n";
+
+static const char menu_script[] =
+    "send \\r\\n   Bethel College Terminal Server\\r\\n"
+    " Please select one of the following:\\r\\n"
+    " 1) Log in to menno\\r\\n 2) Start PPP session\\r\\n"
+    " 3) Hangup and exit\\r\\n Enter Number: \n"
+    "expect 2\n"
+    "ppp\n";
+
+static const char login_script[] =
+    "send \\r\\nlogin: \n"
+    "expect wvbench\n"
+    "send \\r\\nPassword: \n"
+    "expect benchpw\n"
+    "send \\r\\nPPP session from (10.0.0.1) to 10.0.0.2 beginning....\\r\\n"
+    "mtu 1500 ip address is 10.0.0.2\\r\\n\n"
+    "ppp\n";
+
+struct Scenario
+{
+    const char *name;
+    const char *script;		// NULL for LCP straight after CONNECT
+    const char *phone;		// dialed first; Phone1 always connects
+    WvModemSim::Result first;
+};
+
+static const Scenario scenarios[] = {
+    { "connect",   NULL,	 "5551234", WvModemSim::Connect },
+    { "busy",	   NULL,	 "111",	    WvModemSim::Busy },
+    { "nocarrier", NULL,	 "222",	    WvModemSim::NoCarrier },
+    { "menu",	   menu_script,	 "5551234", WvModemSim::Connect },
+    { "login",	   login_script, "5551234", WvModemSim::Connect },
+    { NULL,	   NULL,	 NULL,	    WvModemSim::Connect }
+};
+
+struct Result
+{
+    char	name[ 32 ];
+    long	p50, p99;		// time to Online, ms
+    long	cpu_ms;			// mean per session
+    long	rss_kb;			// largest
+    int		failed;
+};
+
+
+static int cmp_long( const void *a, const void *b )
+/*************************************************/
+{
+    long x = *(const long *)a, y = *(const long *)b;
+    return( x < y ? -1 : x > y );
+}
+
+static long pct( const long *sorted, int n, int p )
+/*************************************************/
+{
+    if( n <= 0 )
+	return( -1 );
+    int i = ( n * p + 99 ) / 100 - 1;
+    return( sorted[ i < 0 ? 0 : i ] );
+}
+
+static bool write_file( WvStringParm name, const char *text, int mode )
+/*********************************************************************/
+{
+    FILE *f = fopen( name, "w" );
+    if( !f )
+	return( false );
+    fputs( text, f );
+    fclose( f );
+    chmod( name, mode );
+    return( true );
+}
+
+static bool run_session( WvModemSim &sim, const char *wvdial,
+			 WvStringParm conf, const char *section,
+			 WvStringParm logfile, struct rusage &ru )
+/*****************************************************************/
+// Runs one wvdial to completion, playing the modem meanwhile.
+{
+    pid_t pid = fork();
+    if( pid < 0 )
+	return( false );
+    if( pid == 0 )
+    {
+	int fd = open( logfile, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fd >= 0 )
+	{
+	    dup2( fd, 1 );
+	    dup2( fd, 2 );
+	}
+	execl( wvdial, wvdial, "--config", conf.cstr(), section, (char *)NULL );
+	_exit( 127 );
+    }
+
+    int status;
+    for( ;; )
+    {
+	pid_t done = wait4( pid, &status, WNOHANG, &ru );
+	if( done == pid )
+	    break;
+
+	WvDialMsec now = wvdial_msecs();
+	fd_set rd;
+	FD_ZERO( &rd );
+	int fd = sim.getfd();
+	if( fd >= 0 )
+	    FD_SET( fd, &rd );
+
+	// the sim wakes us up for the modem; check on wvdial now and then.
+	long ms = sim.msec_until( now );
+	if( ms < 0 || ms > 10 )
+	    ms = 10;
+	struct timeval tv = { 0, ms * 1000 };
+	select( fd + 1, &rd, NULL, NULL, &tv );
+	sim.poll( wvdial_msecs() );
+    }
+    return( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+}
+
+static long read_online_ms( WvStringParm timeline )
+/*************************************************/
+// The last line of the timeline log, if that session made it online.
+{
+    FILE *f = fopen( timeline, "r" );
+    char  line[ 4096 ], last[ 4096 ] = "";
+
+    if( !f )
+	return( -1 );
+    while( fgets( line, sizeof( line ), f ) )
+	strcpy( last, line );
+    fclose( f );
+    unlink( timeline );
+
+    const char *p = strstr( last, "\"total_ms\":" );
+    if( !strstr( last, "\"online\":true" ) || !p )
+	return( -1 );
+    return( atol( p + 11 ) );
+}
+
+static void run_scenario( const Scenario &sc, int sessions, 
+			  const char *wvdial, WvStringParm dir, Result &res )
+/***************************************************************************/
+{
+    WvModemSim sim;
+    WvString   timeline( "%s/%s.timeline", dir, sc.name );
+    WvString   conf( "%s/%s.conf", dir, sc.name );
+    WvString   logfile( "%s/%s.log", dir, sc.name );
+    WvString   stats( "%s/%s.stats", dir, sc.name );
+    WvString   script( "%s/%s.script", dir, sc.name );
+
+    memset( &res, 0, sizeof( res ) );
+    strncpy( res.name, sc.name, sizeof( res.name ) - 1 );
+
+    if( !sim.open() )
+    {
+	perror( "pty" );
+	res.failed = sessions;
+	return;
+    }
+    sim.set_result( sc.phone, sc.first );
+    if( sc.script )
+    {
+	write_file( script, sc.script, 0644 );
+	sim.load_script( script );
+    }
+
+    WvString text( "[Dialer Defaults]\n"
+		   "Modem = %s\nBaud = 115200\nInit1 = ATZ\n"
+		   "Phone = %s\nPhone1 = 5551234\n"
+		   "Username = wvbench\nPassword = benchpw\n"
+		   "PPPD Path = %s/pppd\nNew PPPD = 1\n"
+		   "Carrier Check = 0\nAuto Reconnect = 0\n"
+		   "Check DNS = 0\nCheck Def Route = 0\n"
+		   "Modem Log Rate = 0\nTimeline Log = %s\n"
+		   "Number Stats File = %s\nVirtual Time = %s\n"
+		   "Write Secrets = 0\n",
+		   sim.slave(), sc.phone, dir, timeline, stats, 
+		   virtual_time ? 1 : 0 );
+    write_file( conf, text, 0644 );
+
+    long *online = new long[ sessions ];
+    int   n	 = 0;
+    long  cpu	 = 0;
+
+    for( int i = 0; i < sessions; i++ )
+    {
+	struct rusage ru;
+	memset( &ru, 0, sizeof( ru ) );
+	// every session starts out dialing Phone first: without the
+	// statistics, NO CARRIER would redial it forever.
+	unlink( stats );
+	bool ok = run_session( sim, wvdial, conf, "Defaults", logfile, ru );
+	long ms = read_online_ms( timeline );
+
+	cpu += ( ru.ru_utime.tv_sec + ru.ru_stime.tv_sec ) * 1000
+	     + ( ru.ru_utime.tv_usec + ru.ru_stime.tv_usec ) / 1000;
+	if( ru.ru_maxrss > res.rss_kb )
+	    res.rss_kb = ru.ru_maxrss;
+	if( ok && ms >= 0 )
+	    online[ n++ ] = ms;
+	else
+	    res.failed++;
+    }
+
+    qsort( online, n, sizeof( long ), cmp_long );
+    res.p50    = pct( online, n, 50 );
+    res.p99    = pct( online, n, 99 );
+    res.cpu_ms = sessions ? cpu / sessions : 0;
+    delete[] online;
+
+    if( !res.failed )
+    {
+	unlink( logfile );
+	unlink( conf );
+	unlink( stats );
+	unlink( script );
+    }
+}
+
+static int compare( const Result *results, const char *baseline )
+/***************************************************************/
+// Returns the number of regressions.
+{
+    FILE *f = fopen( baseline, "r" );
+    char  line[ 256 ];
+    int   regressions = 0;
+
+    if( !f )
+    {
+	perror( baseline );
+	return( 1 );
+    }
+
+    printf( "\n%-10s %20s %20s %16s %16s\n", "vs. base", "p50 ms", "p99 ms",
+	    "cpu ms", "rss kB" );
+    while( fgets( line, sizeof( line ), f ) )
+    {
+	Result b;
+	if( line[0] == '#' || sscanf( line, "%31s %ld %ld %ld %ld", b.name,
+				      &b.p50, &b.p99, &b.cpu_ms, &b.rss_kb ) != 5 )
+	    continue;
+
+	const Result *r;
+	for( r = results; r->name[0] && strcmp( r->name, b.name ); r++ )
+	    ;
+	if( !r->name[0] )
+	    continue;
+
+	long	    now[4]  = { r->p50, r->p99, r->cpu_ms, r->rss_kb };
+	long	    then[4] = { b.p50, b.p99, b.cpu_ms, b.rss_kb };
+	printf( "%-10s", r->name );
+	for( int i = 0; i < 4; i++ )
+	{
+	    long d  = now[i] - then[i];
+	    // a few ms (or kB) either way is noise, whatever the percentage.
+	    bool bad = d > 5 && d * 100 > then[i] * REGRESSION_PCT;
+	    printf( " %8ld->%-6ld%s%+4ld%%", then[i], now[i], bad ? "!" : " ",
+		    then[i] ? d * 100 / then[i] : 0 );
+	    if( bad )
+		regressions++;
+	}
+	printf( "\n" );
+    }
+    fclose( f );
+
+    printf( "%d regression%s\n", regressions, regressions == 1 ? "" : "s" );
+    return( regressions );
+}
+
+static void usage( const char *argv0 )
+/************************************/
+{
+    fprintf( stderr, "Usage: %s [-V] [-n sessions] [-b baseline | -w baseline] "
+	     "[wvdial]\n", argv0 );
+    exit( 1 );
+}
+
+
+int main( int argc, char * argv[] )
+/*********************************/
+{
+    int		sessions = 20;
+    const char *baseline = NULL;
+    bool	write	 = false;
+    int		opt;
+
+    while( ( opt = getopt( argc, argv, "Vn:b:w:" ) ) != -1 )
+    {
+	switch( opt )
+	{
+	case 'V': virtual_time = true;			  break;
+	case 'n': sessions = atoi( optarg );		  break;
+	case 'b': baseline = optarg; write = false;	  break;
+	case 'w': baseline = optarg; write = true;	  break;
+	default:  usage( argv[0] );
+	}
+    }
+    const char *wvdial = optind < argc ? argv[ optind ] : "./wvdial";
+    if( sessions <= 0 || access( wvdial, X_OK ) < 0 )
+	usage( argv[0] );
+
+    char dir[] = "/tmp/wvdialperf.XXXXXX";
+    if( !mkdtemp( dir ) )
+    {
+	perror( "mkdtemp" );
+	return( 1 );
+    }
+    write_file( WvString( "%s/pppd", dir ), fake_pppd, 0755 );
+
+    Result results[ sizeof( scenarios ) / sizeof( scenarios[0] ) ];
+    int	   failed = 0;
+
+    printf( "%-10s %8s %8s %8s %8s %8s   (%d sessions each)\n", "scenario",
+	    "p50 ms", "p99 ms", "cpu ms", "rss kB", "failed", sessions );
+    for( int i = 0; scenarios[i].name; i++ )
+    {
+	Result &r = results[i];
+	run_scenario( scenarios[i], sessions, wvdial, dir, r );
+	printf( "%-10s %8ld %8ld %8ld %8ld %8d\n", r.name, r.p50, r.p99,
+		r.cpu_ms, r.rss_kb, r.failed );
+	fflush( stdout );
+	failed += r.failed;
+	results[ i + 1 ].name[0] = '\0';
+    }
+
+    if( failed )
+	printf( "Logs of the failures are in %s.\n", dir );
+    else
+    {
+	unlink( WvString( "%s/pppd", dir ) );
+	rmdir( dir );
+    }
+
+    int regressions = 0;
+    if( baseline && write )
+    {
+	FILE *f = fopen( baseline, "w" );
+	if( !f )
+	{
+	    perror( baseline );
+	    return( 1 );
+	}
+	fprintf( f, "# scenario p50_ms p99_ms cpu_ms rss_kb\n" );
+	for( const Result *r = results; r->name[0]; r++ )
+	    fprintf( f, "%s %ld %ld %ld %ld\n", r->name, r->p50, r->p99,
+		     r->cpu_ms, r->rss_kb );
+	fclose( f );
+    }
+    else if( baseline )
+	regressions = compare( results, baseline );
+
+    return( failed || regressions ? 1 : 0 );
+}
@@ -0,0 +1,209 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Dial several modems at once and keep whichever connects first.  See
+ * wvdialrace.h.
+ *
+ */
+
+#include "wvdialrace.h"
+#include "wvistreamlist.h"
+
+static const char *phone_options[] = {
+    "Phone", "Phone1", "Phone2", "Phone3", "Phone4", NULL
+};
+
+
+WvDialRace::WvDialRace( WvConf &_cfg, WvStringList *_sect_list, 
+			bool _chat_mode )
+/*************************************************************/
+: cfg( _cfg ), log( "WvDial", WvLog::Debug ), num_racers( 0 )
+{
+    const char * d = "Dialer Defaults";
+    WvStringList devices;
+
+    for( int i = 0; i < MAX_RACERS; i++ )
+	racers[i] = NULL;
+
+    if( !_chat_mode )
+	devices.split( cfg.fuzzy_get( *_sect_list, "Race Modems",
+				      cfg.get( d, "Race Modems", "" ) ) );
+
+    if( devices.count() < 2 )
+    {
+	racers[ num_racers++ ] = new WvDialer( cfg, _sect_list, _chat_mode );
+	return;
+    }
+
+    // The numbers, in the order dial() would try them.
+    WvString numbers[5];
+    int      num_numbers = 0;
+    for( int i = 0; phone_options[i]; i++ )
+    {
+	numbers[i] = cfg.fuzzy_get( *_sect_list, phone_options[i],
+				    cfg.get( d, phone_options[i], "" ) );
+	if( !numbers[i] )
+	    break;
+	num_numbers++;
+    }
+
+    // With a "Number Stats File", each dialer sorts the numbers best-first
+    // and starts its own way down that list, so they must all get them in
+    // the usual order; rotating them here as well would undo that.
+    bool stats = !!cfg.fuzzy_get( *_sect_list, "Number Stats File",
+				  cfg.get( d, "Number Stats File", "" ) );
+
+    log( WvLog::Notice, "Racing %s modems: %s\n", devices.count(),
+	 devices.join( " " ) );
+
+    WvStringList::Iter dev( devices );
+    for( dev.rewind(); dev.next() && num_racers < MAX_RACERS; )
+    {
+	// Each racer gets a section of its own, in front of the usual ones,
+	// naming its modem and its own rotation of the phone numbers.
+	int      n = num_racers;
+	int      rotate = stats ? 0 : n;
+	WvString sect( "Race %s", n + 1 );
+
+	cfg.set( sect, "Modem", *dev );
+	for( int i = 0; i < num_numbers; i++ )
+	    cfg.set( sect, phone_options[i],
+		     numbers[ ( rotate + i ) % num_numbers ] );
+
+	sections[n].append( new WvString( sect ), true );
+	WvStringList::Iter i( *_sect_list );
+	for( i.rewind(); i.next(); )
+	    sections[n].append( new WvString( *i ), true );
+	WvDialer::separate_files( cfg, sections[n], sect );
+
+	// the modems are initialised from run()'s event loop, so one that
+	// doesn't answer holds up nobody else.
+	racers[ num_racers++ ] = new WvDialer( cfg, &sections[n], false, true );
+	racers[n]->set_race_offset( stats ? n : 0 );
+    }
+}
+
+WvDialRace::~WvDialRace()
+/***********************/
+{
+    for( int i = 0; i < num_racers; i++ )
+	WVRELEASE( racers[i] );
+}
+
+bool WvDialRace::isok() const
+/***************************/
+{
+    for( int i = 0; i < num_racers; i++ )
+	if( racers[i] && racers[i]->isok() )
+	    return( true );
+    return( false );
+}
+
+int WvDialRace::ask_password()
+/****************************/
+{
+    int ret = racers[0]->ask_password();
+
+    for( int i = 1; i < num_racers; i++ )
+	if( racers[i] )
+	    racers[i]->options.password = racers[0]->options.password;
+    return( ret );
+}
+
+bool WvDialRace::dial()
+/*********************/
+{
+    if( num_racers == 1 )
+	return( racers[0]->dial() );
+
+    bool any = false;
+    for( int i = 0; i < num_racers; i++ )
+    {
+	if( racers[i] && racers[i]->isok() && racers[i]->dial() )
+	    any = true;
+	else
+	    drop( i );
+    }
+    return( any );
+}
+
+bool WvDialRace::connected( WvDialer *dialer )
+/********************************************/
+{
+    switch( dialer->status() )
+    {
+    case WvDialer::WaitAnything:
+    case WvDialer::WaitPrompt:
+    case WvDialer::Online:
+	return( true );
+    default:
+	return( false );
+    }
+}
+
+void WvDialRace::drop( int which )
+/********************************/
+{
+    if( !racers[which] )
+	return;
+
+    racers[which]->hangup();
+    WVRELEASE( racers[which] );
+}
+
+WvDialer *WvDialRace::run( volatile bool &stop )
+/**********************************************/
+{
+    if( num_racers == 1 )
+	return( racers[0] );
+
+    WvIStreamList list;
+    WvDialer *    winner = NULL;
+
+    for( int i = 0; i < num_racers; i++ )
+	if( racers[i] )
+	    list.append( racers[i], false, "WvDial racer" );
+
+    while( !stop && !winner )
+    {
+	int left = 0;
+
+	for( int i = 0; i < num_racers && !winner; i++ )
+	{
+	    if( !racers[i] )
+		continue;
+	    if( connected( racers[i] ) )
+		winner = racers[i];
+	    else if( !racers[i]->isok()
+		     || racers[i]->status() == WvDialer::Idle )
+	    {
+		list.unlink( racers[i] );
+		drop( i );
+	    }
+	    else
+		left++;
+	}
+
+	if( winner || !left )
+	    break;
+
+	list.select( -1 );
+	list.callback();
+    }
+
+    // Everyone else hangs up right away, so the winner's line is the
+    // only one we pay for.
+    for( int i = 0; i < num_racers; i++ )
+    {
+	if( !racers[i] )
+	    continue;
+	list.unlink( racers[i] );
+	if( racers[i] != winner )
+	    drop( i );
+    }
+
+    if( winner )
+	log( WvLog::Notice, "%s connected first.\n", winner->options.modem );
+    return( winner );
+}
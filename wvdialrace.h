@@ -0,0 +1,56 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Dial several modems at once and keep whichever connects first.
+ *
+ */
+
+#ifndef __WVDIALRACE_H
+#define __WVDIALRACE_H
+
+#include "wvdialer.h"
+#include "wvstringlist.h"
+
+class WvDialRace
+/**************/
+// With "Race Modems = /dev/ttyS0 /dev/ttyS1 ...", one WvDialer is created
+// per device, each starting at a different number from Phone, Phone1..4.
+// Without it, this is just a single WvDialer.
+{
+public:
+    WvDialRace( WvConf &_cfg, WvStringList *_sect_list, 
+		bool _chat_mode = false );
+    ~WvDialRace();
+
+    bool	isok() const;
+
+    // The first dialer, for looking at options before the race starts.
+    WvDialer *	first() const
+        { return( racers[0] ); }
+
+    int		ask_password();
+
+    // dial() on every modem; each is initialised and dialed from run().
+    // Returns false if none of them could start.
+    bool	dial();
+
+    // Run every dialer until one of them gets a CONNECT, then hang up the
+    // others.  Returns the winner (still owned by us), or NULL if they
+    // all gave up or 'stop' was set.
+    WvDialer *	run( volatile bool &stop );
+
+private:
+    enum { MAX_RACERS = 8 };
+
+    WvConf &	cfg;
+    WvLog	log;
+    int		num_racers;
+    WvDialer *	racers[ MAX_RACERS ];
+    WvStringList sections[ MAX_RACERS ];
+
+    static bool	connected( WvDialer *dialer );
+    void	drop( int which );
+};
+
+#endif // __WVDIALRACE_H
@@ -0,0 +1,338 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Plays a "Capture File" back to a WvDialer through a pseudo-terminal, so
+ * a dial session from the field can be reproduced and profiled here.
+ *
+ * What the modem said is written to the pty with the same spacing as in
+ * the capture, counted from what the dialer sent just before it; what
+ * the dialer sends is checked against the capture, and any difference or
+ * change in timing is reported.  That is the modem's side, and runs in a
+ * child process, since the dialer waits for answers to its Init strings
+ * before its constructor even returns.  The pppd messages are run through
+ * a WvDialMon of their own once the dialer has started PPP, which here is
+ * /bin/true.
+ *
+ * The exit code is 0 if the dialer sent everything in the capture, and
+ * nothing else; with -o, it must also have got online.
+ *
+ * Usage: wvdialreplay [-o] capture-file config-file [section...]
+ */
+
+#include "wvdialer.h"
+#include "wvdialcapture.h"
+#include "wvdialmon.h"
+#include "wvlogrcv.h"
+#include "uniconfroot.h"
+
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// give up on the dialer if it is this much later than in the capture.
+#define TX_GRACE_MS	10000
+
+volatile bool want_to_die = false;
+
+static void signalhandler( int sig )
+/**********************************/
+{
+    want_to_die = true;
+    signal( sig, SIG_DFL );
+}
+
+static WvString printable( const char *buf, size_t len )
+/******************************************************/
+{
+    char   out[ 256 ];
+    size_t o = 0;
+
+    for( size_t i = 0; i < len && o < sizeof( out ) - 5; i++ )
+    {
+	unsigned char c = buf[i];
+	if( c >= 0x20 && c < 0x7f && c != '\\' )
+	    out[ o++ ] = c;
+	else if( c == '\r' || c == '\n' )
+	{
+	    out[ o++ ] = '\\';
+	    out[ o++ ] = c == '\r' ? 'r' : 'n';
+	}
+	else
+	    o += sprintf( out + o, "\\x%02x", c );
+    }
+    out[ o ] = '\0';
+    return( WvString( out ).unique() );
+}
+
+static int open_pty( WvString &slave )
+/************************************/
+{
+    int master = posix_openpt( O_RDWR | O_NOCTTY );
+    if( master < 0 || grantpt( master ) < 0 || unlockpt( master ) < 0 )
+	return( -1 );
+    slave = ptsname( master );
+    fcntl( master, F_SETFL, O_NONBLOCK );
+    return( master );
+}
+
+static void forget( WvConf &cfg, const char *entry )
+/**************************************************/
+// The replay mustn't write to the files or sockets the real dialer uses.
+{
+    WvConfigSectionList::Iter i( cfg );
+    for( i.rewind(); i.next(); )
+	cfg.set( i->name, entry, "" );
+}
+
+
+static int serve_capture( WvDialCapture &cap, int master )
+/********************************************************/
+// The modem's side of the replay.  Returns the exit code for wvdialreplay.
+{
+    WvLog	log( "WvDial Replay", WvLog::Info );
+    WvDialCapture::Record rec;
+    static char	data[ WvDialCapture::MAX_DATA + 1 ];
+    char	txbuf[ 4096 ];
+    size_t	txlen	   = 0;
+    bool	have	   = cap.next( rec, data, sizeof( data ) - 1 );
+    int		num	   = 1;
+    int		mismatches = 0;
+    long	worst_lag  = 0;
+    WvDialMsec	start	   = wvdial_msecs();
+    WvDialMsec	anchor	   = start;	// when the last record was dealt with
+    unsigned long anchor_ms = 0;		// and its time in the capture
+
+    while( have && !want_to_die )
+    {
+	WvDialMsec now = wvdial_msecs();
+	long due = anchor + ( rec.ms - anchor_ms );
+	ssize_t len;
+
+	// keep up with what the dialer is sending.
+	while( txlen < sizeof( txbuf ) 
+	       && ( len = read( master, txbuf + txlen, 
+				sizeof( txbuf ) - txlen ) ) > 0 )
+	    txlen += len;
+
+	if( rec.type == WvDialCapture::Rx )
+	{
+	    if( now < due )
+		goto wait;
+	    if( write( master, data, rec.len ) != (ssize_t)rec.len )
+		log( WvLog::Warning, "#%s: short write to the pty\n", num );
+	}
+	else if( rec.type == WvDialCapture::Tx )
+	{
+	    if( txlen < rec.len )
+	    {
+		if( now - due > TX_GRACE_MS )
+		{
+		    log( WvLog::Error, "#%s: the dialer never sent \"%s\"; "
+			 "giving up.\n", num, printable( data, rec.len ) );
+		    break;
+		}
+		goto wait;
+	    }
+
+	    if( memcmp( txbuf, data, rec.len ) )
+	    {
+		log( WvLog::Warning, "#%s: sent \"%s\", captured \"%s\"\n", num,
+		     printable( txbuf, rec.len ), printable( data, rec.len ) );
+		mismatches++;
+	    }
+	    txlen -= rec.len;
+	    memmove( txbuf, txbuf + rec.len, txlen );
+
+	    long lag = ( now - start ) - (long)rec.ms;
+	    if( lag > worst_lag )
+		worst_lag = lag;
+	    log( WvLog::Debug, "#%s: tx %sms %s the capture\n", num,
+		 lag < 0 ? -lag : lag, lag < 0 ? "ahead of" : "behind" );
+	}
+	else	// Pppd: the dialer's side deals with those.
+	{
+	    have = cap.next( rec, data, sizeof( data ) - 1 );
+	    num++;
+	    continue;
+	}
+
+	// on to the next record.
+	anchor	  = now;
+	anchor_ms = rec.ms;
+	have	  = cap.next( rec, data, sizeof( data ) - 1 );
+	num++;
+	continue;
+
+    wait:
+	{
+	    // until the next Rx is due, or something comes from the dialer.
+	    fd_set	   rd;
+	    long	   ms = now < due ? due - now : 10;
+	    struct timeval tv = { ms / 1000, ( ms % 1000 ) * 1000 };
+
+	    FD_ZERO( &rd );
+	    FD_SET( master, &rd );
+	    select( master + 1, &rd, NULL, NULL, &tv );
+	}
+    }
+
+    if( have && !want_to_die )
+	log( WvLog::Warning, "Stopped at record #%s of the capture.\n", num );
+    log( "%s mismatches; the dialer ran up to %sms behind the capture.\n",
+	 mismatches, worst_lag );
+    return( mismatches || have ? 1 : 0 );
+}
+
+
+static void replay_pppd( const char *filename, WvLog &log )
+/*********************************************************/
+// Once the dialer has started PPP, what pppd said.
+{
+    WvDialCapture	  cap;
+    WvDialCapture::Record rec;
+    static char		  data[ WvDialCapture::MAX_DATA + 1 ];
+    WvDialMon		  pppmon;
+
+    if( !cap.open( filename ) )
+	return;
+    while( cap.next( rec, data, sizeof( data ) - 1 ) )
+    {
+	if( rec.type != WvDialCapture::Pppd )
+	    continue;
+	data[ rec.len ] = '\0';
+	char *out = pppmon.analyse_line( data );
+	if( out )
+	    log( "pppd: %s\n", out );
+    }
+}
+
+
+int main( int argc, char * argv[] )
+/*********************************/
+{
+    bool need_online = ( argc > 1 && !strcmp( argv[1], "-o" ) );
+    if( need_online )
+    {
+	argc--;
+	argv++;
+    }
+
+    if( argc < 3 )
+    {
+	fprintf( stderr, "Usage: %s [-o] capture-file config-file "
+		 "[section...]\n", argv[0] );
+	return( 1 );
+    }
+
+    WvDialCapture cap;
+    if( !cap.open( argv[1] ) )
+    {
+	fprintf( stderr, "%s: not a capture file\n", argv[1] );
+	return( 1 );
+    }
+
+    WvString slave;
+    int master = open_pty( slave );
+    if( master < 0 )
+    {
+	perror( "pty" );
+	return( 1 );
+    }
+
+    signal( SIGINT, signalhandler );
+    signal( SIGTERM, signalhandler );
+
+    WvLogConsole   rc( dup( 2 ) );
+    UniConfRoot    uniconf( "temp:" );
+    WvConf	   cfg( uniconf );
+    WvStringList   sections;
+    WvLog	   log( "WvDial Replay", WvLog::Info );
+
+    cfg.load_file( argv[2] );
+    for( int i = 3; i < argc; i++ )
+	sections.append( new WvString( "Dialer %s", argv[i] ), true );
+    if( sections.isempty() )
+	sections.append( new WvString( "Dialer Defaults" ), true );
+
+    forget( cfg, "Capture File" );
+    forget( cfg, "Control Socket" );
+    forget( cfg, "Timeline Log" );
+    forget( cfg, "Timeline Stats" );
+    forget( cfg, "Number Stats File" );
+    forget( cfg, "Event FD" );
+    cfg.set( "Command-Line", "Modem", slave );
+    cfg.set( "Command-Line", "Carrier Check", "0" );
+    cfg.set( "Command-Line", "Auto Reconnect", "0" );
+    cfg.set( "Command-Line", "PPPD Path", "/bin/true" );
+    cfg.set( "Command-Line", "Write Secrets", "0" );
+    sections.prepend( new WvString( "Command-Line" ), true );
+
+    time_t captured = cap.started();
+    log( "Replaying %s, captured %s", argv[1], ctime( &captured ) );
+
+    pid_t modem_pid = fork();
+    if( modem_pid < 0 )
+    {
+	perror( "fork" );
+	return( 1 );
+    }
+    if( modem_pid == 0 )
+	_exit( serve_capture( cap, master ) );
+    close( master );
+
+    WvDialer	dialer( cfg, &sections );
+    bool	online	   = false;
+    bool	modem_done = false;
+    int		modem_status = 1;
+    WvDialMsec	done_at	   = 0;
+
+    if( !dialer.isok() || !dialer.dial() )
+	log( WvLog::Error, "The dialer did not start.\n" );
+
+    while( !want_to_die )
+    {
+	if( dialer.status() == WvDialer::Online )
+	    online = true;
+
+	int st;
+	if( !modem_done && waitpid( modem_pid, &st, WNOHANG ) == modem_pid )
+	{
+	    modem_done	 = true;
+	    modem_status = WIFEXITED( st ) ? WEXITSTATUS( st ) : 1;
+	    done_at	 = wvdial_msecs();
+	}
+
+	// once the capture has run out, the dialer gets a moment to finish
+	// what it is doing with the last of it.
+	bool idle = !dialer.isok() || dialer.status() == WvDialer::Idle;
+	if( modem_done && ( online || idle 
+			    || wvdial_msecs() - done_at > TX_GRACE_MS ) )
+	    break;
+
+	if( idle )
+	    usleep( 10000 );
+	else if( dialer.select( 10 ) )
+	    dialer.callback();
+    }
+
+    if( !modem_done )
+    {
+	kill( modem_pid, SIGTERM );
+	waitpid( modem_pid, NULL, 0 );
+    }
+
+    if( online )
+	replay_pppd( argv[1], log );
+
+    log( "Timeline: %s\n", dialer.timeline().json() );
+    log( "The dialer %s online.\n", online ? "got" : "did not get" );
+
+    dialer.hangup();
+    return( modem_status || ( need_online && !online ) ? 1 : 0 );
+}
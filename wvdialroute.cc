@@ -0,0 +1,254 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Finding the IPv4 default route.  See wvdialroute.h.
+ *
+ */
+
+#include "wvdialroute.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/route.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK	12
+#endif
+
+
+WvDialRouteTable::WvDialRouteTable()
+/**********************************/
+: nl( -1 ), cached( false ), cache_found( false )
+{
+    memset( &cache, 0, sizeof( cache ) );
+}
+
+WvDialRouteTable::~WvDialRouteTable()
+/***********************************/
+{
+    close_netlink();
+}
+
+void WvDialRouteTable::use_file( WvStringParm _filename )
+/*******************************************************/
+{
+    filename = _filename;
+    cached   = false;
+    if( !!filename )
+	close_netlink();
+}
+
+bool WvDialRouteTable::default_route( WvDialRoute &rt )
+/*****************************************************/
+{
+    memset( &rt, 0, sizeof( rt ) );
+
+    if( !!filename )
+	return( read_file( rt ) );
+
+    if( nl < 0 && !open_netlink() )
+	return( false );
+
+    if( changed() || !cached )
+    {
+	cache_found = ask_kernel( cache );
+	cached      = true;
+    }
+    rt = cache;
+    return( cache_found );
+}
+
+int WvDialRouteTable::netlink_socket( unsigned groups )
+/*****************************************************/
+{
+    struct sockaddr_nl addr;
+
+    int fd = socket( AF_NETLINK, SOCK_RAW, NETLINK_ROUTE );
+    if( fd < 0 )
+	return( -1 );
+    fcntl( fd, F_SETFD, FD_CLOEXEC );
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = groups;
+    if( bind( fd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 )
+    {
+	::close( fd );
+	return( -1 );
+    }
+    return( fd );
+}
+
+bool WvDialRouteTable::open_netlink()
+/***********************************/
+// This socket only ever hears about changes; the dumps in ask_kernel()
+// each get a socket of their own, so neither can eat the other's
+// messages.
+{
+    nl     = netlink_socket( RTMGRP_IPV4_ROUTE );
+    cached = false;
+    return( nl >= 0 );
+}
+
+void WvDialRouteTable::close_netlink()
+/************************************/
+{
+    if( nl >= 0 )
+	::close( nl );
+    nl     = -1;
+    cached = false;
+}
+
+bool WvDialRouteTable::changed()
+/******************************/
+// Drains any route change notifications; true if there were some.
+{
+    char buf[ 4096 ];
+    bool any = false;
+
+    while( recv( nl, buf, sizeof( buf ), MSG_DONTWAIT ) > 0 )
+	any = true;
+    if( errno == ENOBUFS )	// we missed some; assume the worst
+	any = true;
+    return( any );
+}
+
+bool WvDialRouteTable::ask_kernel( WvDialRoute &rt )
+/**************************************************/
+// Dumps the main IPv4 table and picks the default route (prefix length
+// 0) with the lowest metric.
+{
+    int fd = netlink_socket( 0 );
+    if( fd < 0 )
+	return( false );
+
+    // lets newer kernels filter the dump by table; older ones just say no.
+    int one = 1;
+    setsockopt( fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &one, sizeof( one ) );
+
+    struct {
+	struct nlmsghdr	nh;
+	struct rtmsg	rtm;
+    } req;
+
+    memset( &req, 0, sizeof( req ) );
+    req.nh.nlmsg_len    = NLMSG_LENGTH( sizeof( struct rtmsg ) );
+    req.nh.nlmsg_type   = RTM_GETROUTE;
+    req.nh.nlmsg_flags  = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq    = time( NULL );
+    req.rtm.rtm_family  = AF_INET;
+    req.rtm.rtm_table   = RT_TABLE_MAIN;
+
+    bool	found = false;
+    bool	done  = ( send( fd, &req, req.nh.nlmsg_len, 0 ) < 0 );
+    unsigned	best_metric = 0;
+    char	buf[ 8192 ];
+
+    while( !done )
+    {
+	ssize_t len = recv( fd, buf, sizeof( buf ), 0 );
+	if( len < 0 && errno == EINTR )
+	    continue;
+	if( len <= 0 )
+	    break;
+
+	for( struct nlmsghdr *nh = (struct nlmsghdr *)buf; 
+	     !done && NLMSG_OK( nh, (size_t)len ); nh = NLMSG_NEXT( nh, len ) )
+	{
+	    if( nh->nlmsg_seq != req.nh.nlmsg_seq )
+		continue;
+	    if( nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR )
+	    {
+		done = true;
+		continue;
+	    }
+	    if( nh->nlmsg_type != RTM_NEWROUTE )
+		continue;
+
+	    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA( nh );
+	    if( rtm->rtm_family != AF_INET || rtm->rtm_dst_len != 0
+		|| rtm->rtm_type != RTN_UNICAST )
+		continue;
+
+	    unsigned	table  = rtm->rtm_table;
+	    unsigned	metric = 0;
+	    int		oif    = 0;
+	    in_addr_t	gw     = 0;
+	    int		alen   = RTM_PAYLOAD( nh );
+
+	    for( struct rtattr *a = RTM_RTA( rtm ); RTA_OK( a, alen );
+		 a = RTA_NEXT( a, alen ) )
+	    {
+		switch( a->rta_type )
+		{
+		case RTA_TABLE:	   table  = *(unsigned *)RTA_DATA( a ); break;
+		case RTA_PRIORITY: metric = *(unsigned *)RTA_DATA( a ); break;
+		case RTA_OIF:	   oif    = *(int *)RTA_DATA( a );	break;
+		case RTA_GATEWAY:  gw     = *(in_addr_t *)RTA_DATA( a ); break;
+		}
+	    }
+	    if( table != RT_TABLE_MAIN || ( found && metric >= best_metric ) )
+		continue;
+
+	    found       = true;
+	    best_metric = metric;
+	    rt.gateway  = gw;
+	    if( !oif || !if_indextoname( oif, rt.dev ) )
+		rt.dev[0] = '\0';
+	}
+    }
+
+    ::close( fd );
+    return( found );
+}
+
+bool WvDialRouteTable::read_file( WvDialRoute &rt )
+/*************************************************/
+// The /proc/net/route format: a header line, then one route per line as
+// "Iface Destination Gateway Flags RefCnt Use Metric Mask ...", with the
+// addresses in hex.
+{
+    FILE *f = fopen( filename, "r" );
+    if( f == NULL )
+	return( false );
+
+    char	line[ 512 ];
+    bool	found = false;
+    unsigned	best_metric = 0;
+
+    if( fgets( line, sizeof( line ), f ) == NULL )	// header
+	line[0] = '\0';
+
+    while( fgets( line, sizeof( line ), f ) != NULL )
+    {
+	char		dev[ 64 ];
+	unsigned long	dest, gw, flags, refcnt, use, metric, mask;
+
+	if( sscanf( line, "%63s %lx %lx %lx %lu %lu %lu %lx", dev, &dest, &gw,
+		    &flags, &refcnt, &use, &metric, &mask ) != 8 )
+	    continue;
+	if( !( flags & RTF_UP ) || dest != 0 || mask != 0 )
+	    continue;
+	if( found && metric >= best_metric )
+	    continue;
+
+	found       = true;
+	best_metric = metric;
+	rt.gateway  = gw;
+	strncpy( rt.dev, dev, sizeof( rt.dev ) - 1 );
+	rt.dev[ sizeof( rt.dev ) - 1 ] = '\0';
+    }
+
+    fclose( f );
+    return( found );
+}
@@ -0,0 +1,57 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Finding the IPv4 default route, for checking it points at our link.
+ *
+ */
+
+#ifndef __WVDIALROUTE_H
+#define __WVDIALROUTE_H
+
+#include <net/if.h>
+#include <netinet/in.h>
+
+#include "wvstring.h"
+
+struct WvDialRoute
+/****************/
+{
+    char	dev[ IF_NAMESIZE ];	// "" if unknown
+    in_addr_t	gateway;		// 0 for a plain device route
+};
+
+
+class WvDialRouteTable
+/********************/
+// Normally asks the kernel over rtnetlink, and remembers the answer until
+// the kernel announces a change to the IPv4 routes, so asking again is
+// free.  Given a file in /proc/net/route format instead, it reads that
+// every time; that is mostly for testing.
+{
+public:
+    WvDialRouteTable();
+    ~WvDialRouteTable();
+
+    // "" goes back to asking the kernel.
+    void	use_file( WvStringParm _filename );
+
+    // Returns false if there is no default route (or we can't tell).
+    bool	default_route( WvDialRoute &rt );
+
+private:
+    WvString	filename;
+    int		nl;		// rtnetlink, subscribed to route changes
+    bool	cached;
+    bool	cache_found;
+    WvDialRoute	cache;
+
+    bool	open_netlink();
+    static int	netlink_socket( unsigned groups );
+    void	close_netlink();
+    bool	changed();
+    bool	ask_kernel( WvDialRoute &rt );
+    bool	read_file( WvDialRoute &rt );
+};
+
+#endif // __WVDIALROUTE_H
@@ -0,0 +1,153 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Implementation of the WvDialer receive ring buffer.
+ *
+ */
+
+#include "wvdialrxbuf.h"
+#include "wvdialmatch.h"
+
+#include <string.h>
+
+WvDialRxBuf::WvDialRxBuf()
+/************************/
+{
+    lost = 0;
+    clear();
+}
+
+
+void WvDialRxBuf::clear()
+/***********************/
+{
+    head = tail = 0;
+    scan_matcher = NULL;
+    rewind_scan( 0 );
+    store[0] = '\0';
+}
+
+
+void WvDialRxBuf::append( const char * data, size_t len )
+/*******************************************************/
+{
+    // one slot always stays free, for the NUL terminator.
+    if( len > SIZE-1 ) 
+    {
+	lost += len - ( SIZE-1 );
+	data += len - ( SIZE-1 );
+	len = SIZE-1;
+    }
+    if( used() + len > SIZE-1 ) 
+    {
+	size_t drop = used() + len - ( SIZE-1 );
+	lost += drop;
+	consume( drop );
+    }
+
+    while( len > 0 ) 
+    {
+	size_t i = tail & ( SIZE-1 );
+	size_t n = SIZE - i;
+
+	if( n > len )
+	    n = len;
+	memcpy( store + i, data, n );
+	memcpy( store + i + SIZE, data, n );
+	tail += n;
+	data += n;
+	len -= n;
+    }
+
+    terminate();
+}
+
+
+void WvDialRxBuf::consume( size_t n )
+/***********************************/
+{
+    if( n > used() )
+	n = used();
+
+    head += n;
+    if( scanned < head )
+	rewind_scan( head );
+    else if( pending >= 0 && pending_end <= head )
+	pending = -1;		// the match was thrown away
+    terminate();
+}
+
+
+void WvDialRxBuf::consume_to( const char * p )
+/********************************************/
+{
+    const char * base = str();
+
+    if( p > base )
+	consume( p - base );
+}
+
+
+void WvDialRxBuf::rewind_scan( unsigned long pos )
+/************************************************/
+{
+    scan_state = WvDialMatcher::START;
+    scanned = pos;
+    pending = -1;
+}
+
+
+int WvDialRxBuf::match( const WvDialMatcher & m, bool neednewline )
+/*****************************************************************/
+{
+    // a different table has to look at everything again.
+    if( &m != scan_matcher || neednewline != scan_newline ) 
+    {
+	scan_matcher = &m;
+	scan_newline = neednewline;
+	rewind_scan( head );
+    }
+
+    // thanks to the mirror, everything from 'scanned' to the end is
+    // contiguous.
+    const unsigned char * p = (const unsigned char *)
+				store + ( scanned & ( SIZE-1 ) );
+
+    while( scanned < tail ) 
+    {
+	unsigned char c = *p++;
+	scanned++;
+
+	scan_state = m.step( scan_state, c );
+
+	if( pending >= 0 && ( c == '\r' || c == '\n' ) ) 
+	{
+	    int result = pending;
+	    unsigned long end = pending_end;
+	    consume( end - head );
+	    rewind_scan( end );
+	    return( result );
+	}
+
+	int found = m.output( scan_state );
+	if( found < 0 )
+	    continue;
+
+	if( !neednewline ) 
+	{
+	    consume( scanned - head );
+	    rewind_scan( head );
+	    return( found );
+	}
+	
+	// found, but the line isn't finished yet.
+	if( pending < 0 ) 
+	{
+	    pending = found;
+	    pending_end = scanned;
+	}
+    }
+
+    return( -1 );
+}
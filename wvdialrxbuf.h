@@ -0,0 +1,80 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * The receive buffer behind WvDialer::wait_for_modem().
+ *
+ */
+
+#ifndef __WVDIALRXBUF_H
+#define __WVDIALRXBUF_H
+
+#include <stddef.h>
+
+class WvDialMatcher;
+
+class WvDialRxBuf
+/***************/
+// A ring buffer of (already lowercased) modem input.  Every byte is stored
+// twice, SIZE bytes apart, so the unconsumed data is always available as
+// one contiguous, NUL-terminated string for strstr() and WvDialBrain
+// without ever copying it around.
+//
+// Two cursors move through the data: 'consumed' marks what the dialer is
+// done with, and 'scanned' remembers how far the response matcher has
+// already looked (and in which state it was), so a new read only costs a
+// scan of the new bytes.
+{
+public:
+    enum { SIZE = 1024 };		// must be a power of two
+
+    WvDialRxBuf();
+
+    // Add 'len' new bytes.  If they don't fit, the oldest data is dropped:
+    // the newest response always survives.
+    void	append( const char * data, size_t len );
+
+    // Look for any of the matcher's strings in the unconsumed data.  If
+    // 'neednewline' is set, a match only counts once a CR or LF follows
+    // it.  On success, the data up to the end of the match is consumed and
+    // the index into the matcher's table is returned; otherwise -1.  The
+    // earliest match in the data wins.
+    int		match( const WvDialMatcher & m, bool neednewline );
+
+    // The unconsumed data, NUL-terminated.
+    char *	str()
+        { return( store + ( head & ( SIZE-1 ) ) ); }
+    size_t	used() const
+        { return( tail - head ); }
+
+    // Throw away everything before 'p', which points into str().
+    void	consume_to( const char * p );
+    void	consume( size_t n );
+    void	clear();
+
+    // Number of bytes we had to drop because the buffer was full.
+    unsigned long dropped() const
+        { return( lost ); }
+
+private:
+    char		store[ 2*SIZE ];
+    unsigned long	head;		// 'consumed' cursor
+    unsigned long	tail;		// end of the data
+    unsigned long	lost;
+
+    // matcher state; 'scanned' and 'pending_end' are positions like
+    // head and tail.
+    const WvDialMatcher *scan_matcher;
+    bool		scan_newline;
+    int			scan_state;
+    unsigned long	scanned;
+    int			pending;	// a match waiting for its newline
+    unsigned long	pending_end;
+
+    void	rewind_scan( unsigned long pos );
+
+    void	terminate()
+        { store[ ( head & ( SIZE-1 ) ) + used() ] = '\0'; }
+};
+
+#endif // __WVDIALRXBUF_H
@@ -0,0 +1,200 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Periodic samples of a network interface's counters.  See
+ * wvdialsampler.h.
+ *
+ */
+
+#include "wvdialsampler.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char * const WvDialSample::counter_names[ NUM_COUNTERS ] = {
+    "rx_bytes", "tx_bytes", "rx_packets", "tx_packets",
+    "rx_errors", "tx_errors", "rx_dropped", "tx_dropped"
+};
+
+
+WvDialSampler::WvDialSampler()
+/****************************/
+: head( 0 ), n( 0 )
+{
+    iface[0] = '\0';
+    for( int i = 0; i < WvDialSample::NUM_COUNTERS; i++ )
+	fds[i] = -1;
+    memset( &first, 0, sizeof( first ) );
+}
+
+WvDialSampler::~WvDialSampler()
+/*****************************/
+{
+    stop();
+}
+
+bool WvDialSampler::start( const char *_iface )
+/*********************************************/
+{
+    stop();
+    strncpy( iface, _iface, sizeof( iface ) - 1 );
+    iface[ sizeof( iface ) - 1 ] = '\0';
+    head = n = 0;
+
+    for( int i = 0; i < WvDialSample::NUM_COUNTERS; i++ )
+    {
+	char path[ 128 ];
+	snprintf( path, sizeof( path ), "/sys/class/net/%s/statistics/%s",
+		  iface, WvDialSample::counter_names[i] );
+	fds[i] = open( path, O_RDONLY );
+	if( fds[i] < 0 )
+	{
+	    stop();
+	    return( false );
+	}
+    }
+
+    if( !read_counters( last_raw ) )
+    {
+	stop();
+	return( false );
+    }
+    memset( &first, 0, sizeof( first ) );
+    return( true );
+}
+
+void WvDialSampler::stop()
+/************************/
+{
+    for( int i = 0; i < WvDialSample::NUM_COUNTERS; i++ )
+    {
+	if( fds[i] >= 0 )
+	    close( fds[i] );
+	fds[i] = -1;
+    }
+}
+
+bool WvDialSampler::read_counters( unsigned long long *raw )
+/**********************************************************/
+{
+    for( int i = 0; i < WvDialSample::NUM_COUNTERS; i++ )
+    {
+	char	buf[ 32 ];
+	ssize_t len = pread( fds[i], buf, sizeof( buf ) - 1, 0 );
+	if( len <= 0 )
+	    return( false );
+	buf[ len ] = '\0';
+	raw[i] = strtoull( buf, NULL, 10 );
+    }
+    return( true );
+}
+
+bool WvDialSampler::sample( WvDialMsec now )
+/******************************************/
+{
+    unsigned long long raw[ WvDialSample::NUM_COUNTERS ];
+
+    if( !running() || !read_counters( raw ) )
+    {
+	stop();
+	return( false );
+    }
+
+    // counters are kept relative to start(), so they begin at zero and
+    // carry on from where they were if the kernel's go back to zero.
+    const WvDialSample &prev = n ? get( n - 1 ) : first;
+    WvDialSample       &s    = ring[ head ];
+
+    s.when = now;
+    for( int i = 0; i < WvDialSample::NUM_COUNTERS; i++ )
+    {
+	unsigned long long delta = raw[i] >= last_raw[i] 
+	    ? raw[i] - last_raw[i] : raw[i];
+	s.count[i]  = prev.count[i] + delta;
+	last_raw[i] = raw[i];
+    }
+
+    head = ( head + 1 ) % SIZE;
+    if( n < SIZE )
+	n++;
+    return( true );
+}
+
+unsigned long long WvDialSampler::total( WvDialSample::Counter c ) const
+/**********************************************************************/
+{
+    return( n ? get( n - 1 ).count[c] : 0 );
+}
+
+bool WvDialSampler::rates( WvDialLinkRates &r, WvDialMsec window_ms ) const
+/*************************************************************************/
+{
+    memset( &r, 0, sizeof( r ) );
+    if( n < 2 )
+	return( false );
+
+    const WvDialSample &b = get( n - 1 );
+    int i = 0;
+    if( window_ms > 0 )
+    {
+	// the oldest sample still inside the window, but at least one back
+	i = n - 2;
+	while( i > 0 && b.when - get( i - 1 ).when <= window_ms )
+	    i--;
+    }
+    const WvDialSample &a = get( i );
+
+    r.span = b.when - a.when;
+    if( r.span <= 0 )
+	return( false );
+
+    unsigned long long d[ WvDialSample::NUM_COUNTERS ];
+    for( int c = 0; c < WvDialSample::NUM_COUNTERS; c++ )
+	d[c] = b.count[c] - a.count[c];
+
+    double secs = r.span / 1000.0;
+    r.rx_bps = d[ WvDialSample::RxBytes ]   / secs;
+    r.tx_bps = d[ WvDialSample::TxBytes ]   / secs;
+    r.rx_pps = d[ WvDialSample::RxPackets ] / secs;
+    r.tx_pps = d[ WvDialSample::TxPackets ] / secs;
+
+    unsigned long long packets = d[ WvDialSample::RxPackets ] 
+	+ d[ WvDialSample::TxPackets ];
+    if( packets )
+    {
+	r.error_rate = (double)( d[ WvDialSample::RxErrors ]
+				 + d[ WvDialSample::TxErrors ] ) / packets;
+	r.drop_rate  = (double)( d[ WvDialSample::RxDropped ]
+				 + d[ WvDialSample::TxDropped ] ) / packets;
+    }
+    return( true );
+}
+
+WvString WvDialSampler::json( WvDialMsec window_ms ) const
+/********************************************************/
+{
+    char buf[ 512 ];
+    int	 len = snprintf( buf, sizeof( buf ), "{\"interface\":\"%s\"", iface );
+
+    for( int c = 0; c < WvDialSample::NUM_COUNTERS && len < (int)sizeof( buf ); c++ )
+	len += snprintf( buf + len, sizeof( buf ) - len, ",\"%s\":%llu",
+			 WvDialSample::counter_names[c],
+			 total( (WvDialSample::Counter)c ) );
+
+    WvDialLinkRates r;
+    if( rates( r, window_ms ) && len < (int)sizeof( buf ) )
+	len += snprintf( buf + len, sizeof( buf ) - len,
+			 ",\"span_ms\":%lld,\"rx_bps\":%.1f,\"tx_bps\":%.1f,"
+			 "\"rx_pps\":%.1f,\"tx_pps\":%.1f,"
+			 "\"error_rate\":%.6f,\"drop_rate\":%.6f",
+			 r.span, r.rx_bps, r.tx_bps, r.rx_pps, r.tx_pps,
+			 r.error_rate, r.drop_rate );
+
+    if( len < (int)sizeof( buf ) - 1 )
+	strcpy( buf + len, "}" );
+    return( WvString( buf ).unique() );
+}
@@ -0,0 +1,101 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Periodic samples of a network interface's counters, for seeing how well
+ * the link is doing while we are online.
+ *
+ */
+
+#ifndef __WVDIALSAMPLER_H
+#define __WVDIALSAMPLER_H
+
+#include <net/if.h>
+
+#include "wvstring.h"
+#include "wvdialtimer.h"
+
+struct WvDialSample
+/*****************/
+{
+    enum Counter {
+	RxBytes, TxBytes, RxPackets, TxPackets,
+	RxErrors, TxErrors, RxDropped, TxDropped,
+	NUM_COUNTERS
+    };
+    static const char * const counter_names[ NUM_COUNTERS ];
+
+    WvDialMsec		when;
+    unsigned long long	count[ NUM_COUNTERS ];
+};
+
+
+struct WvDialLinkRates
+/********************/
+// Averages between two samples.
+{
+    WvDialMsec	span;			// milliseconds covered
+    double	rx_bps, tx_bps;		// bytes per second
+    double	rx_pps, tx_pps;		// packets per second
+    double	error_rate;		// errors per packet, both directions
+    double	drop_rate;		// drops per packet, both directions
+};
+
+
+class WvDialSampler
+/*****************/
+// Keeps the interface's statistics files open and re-reads them at each
+// sample(), so taking a sample is a handful of pread()s.  The last SIZE
+// samples are kept in a ring; the counters are made monotonic across a
+// reset (eg. if the interface was recreated).
+{
+public:
+    enum { SIZE = 64 };
+
+    WvDialSampler();
+    ~WvDialSampler();
+
+    // Starts over on a new interface, eg. "ppp0".  Returns false if its
+    // statistics can't be read.
+    bool	start( const char *_iface );
+
+    // Closes the files, but keeps the samples for querying.
+    void	stop();
+
+    bool	running() const
+        { return( fds[0] >= 0 ); }
+    const char *interface() const
+        { return( iface ); }
+
+    // Take a sample now.  Returns false if the interface went away.
+    bool	sample( WvDialMsec now );
+
+    // Samples in the ring; 0 is the oldest.
+    int		count() const
+        { return( n ); }
+    const WvDialSample &get( int i ) const
+        { return( ring[ ( head + SIZE - n + i ) % SIZE ] ); }
+
+    // Rates over (about) the last window_ms, or over everything in the
+    // ring if window_ms is 0.  Returns false with fewer than two samples.
+    bool	rates( WvDialLinkRates &r, WvDialMsec window_ms = 0 ) const;
+
+    // Totals since start(), as of the latest sample.
+    unsigned long long total( WvDialSample::Counter c ) const;
+
+    // The current totals and rates as one line of JSON.
+    WvString	json( WvDialMsec window_ms = 0 ) const;
+
+private:
+    char		iface[ IF_NAMESIZE ];
+    int			fds[ WvDialSample::NUM_COUNTERS ];
+    unsigned long long	last_raw[ WvDialSample::NUM_COUNTERS ];
+    WvDialSample	first;		// the baseline at start()
+    WvDialSample	ring[ SIZE ];
+    int			head;		// where the next sample goes
+    int			n;
+
+    bool	read_counters( unsigned long long *raw );
+};
+
+#endif // __WVDIALSAMPLER_H
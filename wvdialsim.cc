@@ -0,0 +1,150 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Runs a WvModemSim, so that wvdial (or wvdialreplay, or anything else)
+ * can dial out on a plain Linux box.  Prints the pty to use as "Modem",
+ * and runs until killed, or until the given number of calls are over.
+ *
+ * A terminal server like the ones in MENUS might be scripted as
+ *
+ *	send \r\n   Bethel College Terminal Server\r\n
+ *	send  1) Log in to menno\r\n 2) Start PPP session\r\n
+ *	send  Enter Number: 
+ *	expect 2
+ *	send \r\nmtu 1500, ip address is 10.0.0.2\r\n
+ *	ppp
+ *
+ * Usage: wvdialsim [-r result] [-n number=result]... [-l response-ms]
+ *		    [-d dial-ms] [-b byte-ms] [-s script] [-p ppp-command]
+ *		    [-c calls] [-o pty-file]
+ */
+
+#include "wvmodemsim.h"
+
+#include <sys/select.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static volatile bool want_to_die = false;
+
+static void signalhandler( int sig )
+/**********************************/
+{
+    want_to_die = true;
+}
+
+static void usage( const char *argv0 )
+/************************************/
+{
+    fprintf( stderr, 
+	     "Usage: %s [-r result] [-n number=result]... [-l response-ms]\n"
+	     "\t[-d dial-ms] [-b byte-ms] [-s script] [-p ppp-command]\n"
+	     "\t[-c calls] [-o pty-file]\n"
+	     "Results are CONNECT, BUSY, \"NO CARRIER\", \"NO DIALTONE\" "
+	     "and \"NO ANSWER\".\n", argv0 );
+    exit( 1 );
+}
+
+
+int main( int argc, char * argv[] )
+/*********************************/
+{
+    WvModemSim		sim;
+    WvModemSim::Result	r;
+    int			response_ms = 0, dial_ms = 0, byte_ms = 0;
+    int			max_calls = 0;
+    const char *	ptyfile = NULL;
+    int			opt;
+
+    while( ( opt = getopt( argc, argv, "r:n:l:d:b:s:p:c:o:" ) ) != -1 )
+    {
+	switch( opt )
+	{
+	case 'r':
+	    if( !WvModemSim::parse_result( optarg, r ) )
+		usage( argv[0] );
+	    sim.set_result( r );
+	    break;
+	case 'n':
+	{
+	    char *eq = strchr( optarg, '=' );
+	    if( !eq )
+		usage( argv[0] );
+	    *eq = '\0';
+	    if( !WvModemSim::parse_result( eq + 1, r ) 
+		|| !sim.set_result( optarg, r ) )
+		usage( argv[0] );
+	    break;
+	}
+	case 'l': response_ms = atoi( optarg ); break;
+	case 'd': dial_ms     = atoi( optarg ); break;
+	case 'b': byte_ms     = atoi( optarg ); break;
+	case 'c': max_calls   = atoi( optarg ); break;
+	case 'o': ptyfile     = optarg;		break;
+	case 'p': sim.set_ppp_command( optarg ); break;
+	case 's':
+	    if( !sim.load_script( optarg ) )
+	    {
+		fprintf( stderr, "%s: cannot load script %s\n", argv[0], optarg );
+		return( 1 );
+	    }
+	    break;
+	default:
+	    usage( argv[0] );
+	}
+    }
+    sim.set_delays( response_ms, dial_ms, byte_ms );
+
+    if( !sim.open() )
+    {
+	perror( "pty" );
+	return( 1 );
+    }
+
+    printf( "%s\n", sim.slave() );
+    fflush( stdout );
+    if( ptyfile )
+    {
+	FILE *f = fopen( ptyfile, "w" );
+	if( f )
+	{
+	    fprintf( f, "%s\n", sim.slave() );
+	    fclose( f );
+	}
+    }
+
+    signal( SIGINT, signalhandler );
+    signal( SIGTERM, signalhandler );
+    signal( SIGPIPE, SIG_IGN );
+
+    while( !want_to_die )
+    {
+	WvDialMsec now = wvdial_msecs();
+	
+	if( max_calls && sim.calls() >= max_calls && !sim.connected() )
+	    break;
+
+	fd_set rd;
+	FD_ZERO( &rd );
+	int fd = sim.getfd();
+	if( fd >= 0 )
+	    FD_SET( fd, &rd );
+
+	long ms = sim.msec_until( now );
+	struct timeval tv, *tvp = NULL;
+	if( ms >= 0 )
+	{
+	    tv.tv_sec  = ms / 1000;
+	    tv.tv_usec = ( ms % 1000 ) * 1000;
+	    tvp = &tv;
+	}
+	select( fd + 1, &rd, NULL, NULL, tvp );
+	sim.poll( wvdial_msecs() );
+    }
+
+    return( 0 );
+}
@@ -0,0 +1,208 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Persistent per-number dial statistics.  See wvdialstats.h.
+ *
+ */
+
+#include "wvdialstats.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#define STATS_MAGIC	"WvDs"
+#define STATS_VERSION	1
+
+// what a number that has never connected is worth, before its attempts
+#define NEVER_CONNECTED	1000000000LL
+
+
+WvDialNumberStats::WvDialNumberStats()
+/************************************/
+: fd( -1 ), map( NULL )
+{
+}
+
+WvDialNumberStats::~WvDialNumberStats()
+/*************************************/
+{
+    close();
+}
+
+bool WvDialNumberStats::open( WvStringParm _filename )
+/****************************************************/
+// A file with the wrong magic, version or layout is started over.  That is
+// decided under the lock, so another wvdial opening the file at the same
+// time can't start it over after we have.
+{
+    close();
+    fname = _filename;
+
+    fd = ::open( fname, O_RDWR | O_CREAT, 0644 );
+    if( fd < 0 )
+	return( false );
+
+    lock();
+    struct stat st;
+    bool fresh = ( fstat( fd, &st ) < 0 || st.st_size != sizeof( Header ) );
+    void *p    = MAP_FAILED;
+    if( !fresh || ftruncate( fd, sizeof( Header ) ) == 0 )
+	p = mmap( NULL, sizeof( Header ), PROT_READ | PROT_WRITE,
+		  MAP_SHARED, fd, 0 );
+    if( p == MAP_FAILED )
+    {
+	unlock();
+	close();
+	return( false );
+    }
+    map = (Header *)p;
+
+    if( fresh || memcmp( map->magic, STATS_MAGIC, 4 )
+	|| map->version != STATS_VERSION
+	|| map->record_size != sizeof( Record )
+	|| map->num_records > MAX_RECORDS )
+    {
+	memset( map, 0, sizeof( Header ) );
+	memcpy( map->magic, STATS_MAGIC, 4 );
+	map->version     = STATS_VERSION;
+	map->record_size = sizeof( Record );
+    }
+    unlock();
+    return( true );
+}
+
+void WvDialNumberStats::close()
+/*****************************/
+{
+    if( map )
+	munmap( map, sizeof( Header ) );
+    if( fd >= 0 )
+	::close( fd );
+    map = NULL;
+    fd  = -1;
+}
+
+void WvDialNumberStats::lock() const
+/**********************************/
+// Errors are ignored: without a lock we are no worse off than before.
+{
+    while( flock( fd, LOCK_EX ) < 0 && errno == EINTR )
+	;
+}
+
+void WvDialNumberStats::unlock() const
+/************************************/
+{
+    flock( fd, LOCK_UN );
+}
+
+WvDialNumberStats::Record *WvDialNumberStats::find( WvStringParm number,
+						    bool create ) const
+/**************************************************************************/
+// Call with the file locked.
+{
+    if( !map || !number )
+	return( NULL );
+
+    Record *oldest = NULL;
+    for( uint32_t i = 0; i < map->num_records; i++ )
+    {
+	Record &r = map->records[i];
+	if( !strncmp( r.number, number, MAX_NUMBER - 1 ) )
+	    return( &r );
+	if( !oldest || r.last_used < oldest->last_used )
+	    oldest = &r;
+    }
+
+    if( !create )
+	return( NULL );
+
+    Record *r = map->num_records < MAX_RECORDS 
+			? &map->records[ map->num_records++ ] : oldest;
+    memset( r, 0, sizeof( *r ) );
+    strncpy( r->number, number, MAX_NUMBER - 1 );
+    return( r );
+}
+
+void WvDialNumberStats::attempt( WvStringParm number, int result, long ms )
+/*************************************************************************/
+{
+    if( !map )
+	return;
+
+    lock();
+    Record *r = find( number, true );
+    if( r )
+    {
+	r->last_used = time( NULL );
+	r->attempts++;
+	r->attempt_ms += ms;
+	if( result >= 0 && result < NUM_RESULTS )
+	    r->results[ result ]++;
+	if( result == 0 )
+	{
+	    r->connects++;
+	    r->connect_ms += ms;
+	}
+    }
+    unlock();
+}
+
+void WvDialNumberStats::ip_up( WvStringParm number, long ms )
+/***********************************************************/
+{
+    if( !map )
+	return;
+
+    lock();
+    Record *r = find( number, true );
+    if( r )
+    {
+	r->ip_ups++;
+	r->ipup_ms += ms;
+    }
+    unlock();
+}
+
+void WvDialNumberStats::online( WvStringParm number, long ms )
+/************************************************************/
+{
+    if( !map )
+	return;
+
+    lock();
+    Record *r = find( number, true );
+    if( r )
+    {
+	r->sessions++;
+	r->online_ms += ms;
+    }
+    unlock();
+}
+
+long long WvDialNumberStats::expected_ms( WvStringParm number ) const
+/*******************************************************************/
+{
+    if( !map )
+	return( 0 );
+
+    lock();
+    long long	  ms = 0;
+    const Record *r  = find( number, false );
+    if( r && r->attempts )
+    {
+	if( !r->connects )
+	    ms = NEVER_CONNECTED + r->attempt_ms;
+	else
+	    ms = r->attempt_ms / r->connects;
+    }
+    unlock();
+    return( ms );
+}
@@ -0,0 +1,91 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A small persistent file of how well each phone number has worked, so
+ * the dialer can try the best ones first.
+ *
+ */
+
+#ifndef __WVDIALSTATS_H
+#define __WVDIALSTATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "wvstring.h"
+
+class WvDialNumberStats
+/*********************/
+// The file is a header followed by MAX_RECORDS fixed-size records, and is
+// mmap()ed shared, so every update is on disk (eventually) without any
+// explicit writes.  When it fills up, the least recently used number is
+// forgotten.  Opening, updates and lookups hold an flock() on the file, so
+// several wvdials can share one.
+{
+public:
+    enum { 
+	MAX_RECORDS = 64,
+	MAX_NUMBER  = 64,
+	NUM_RESULTS = 8		// 0 is CONNECT, the rest are dial_stat codes
+    };
+
+    WvDialNumberStats();
+    ~WvDialNumberStats();
+
+    bool	open( WvStringParm _filename );
+    void	close();
+    bool	isok() const
+        { return( map != NULL ); }
+    WvString	filename() const
+        { return( fname ); }
+
+    // One dial attempt on 'number', which ended with 'result' (0 for
+    // CONNECT, otherwise the dialer's dial_stat) after 'ms' milliseconds.
+    void	attempt( WvStringParm number, int result, long ms );
+
+    // How long from dialing until ip-up finished, and how long the
+    // connection then lasted.
+    void	ip_up( WvStringParm number, long ms );
+    void	online( WvStringParm number, long ms );
+
+    // Expected dialing time per successful CONNECT: all the time spent on
+    // the number, failures included, divided by how often it connected.
+    // Numbers we know nothing about come out as 0, so they get tried.
+    long long	expected_ms( WvStringParm number ) const;
+
+private:
+    struct Record
+    {
+	char		number[ MAX_NUMBER ];
+	time_t		last_used;
+	uint32_t	attempts;
+	uint32_t	connects;
+	uint32_t	ip_ups;
+	uint32_t	sessions;
+	uint32_t	results[ NUM_RESULTS ];
+	uint64_t	attempt_ms;	// every attempt, however it ended
+	uint64_t	connect_ms;	// dial to CONNECT
+	uint64_t	ipup_ms;	// dial to ip-up finished
+	uint64_t	online_ms;	// connection length
+    };
+
+    struct Header
+    {
+	char		magic[ 4 ];
+	uint32_t	version;
+	uint32_t	record_size;
+	uint32_t	num_records;
+	Record		records[ MAX_RECORDS ];
+    };
+
+    WvString	fname;
+    int		fd;
+    Header *	map;
+
+    Record *	find( WvStringParm number, bool create ) const;
+    void	lock() const;
+    void	unlock() const;
+};
+
+#endif // __WVDIALSTATS_H
@@ -0,0 +1,171 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Implementation of the WvDialer deadline scheduler.
+ *
+ */
+
+#include "wvdialtimer.h"
+
+#include <sys/time.h>
+#include <assert.h>
+
+static WvDialClock  monotonic;
+static WvDialClock *current = &monotonic;
+
+void wvdial_set_clock( WvDialClock *clock )
+/*****************************************/
+{
+    current = clock ? clock : &monotonic;
+}
+
+
+WvDialClock &wvdial_clock()
+/*************************/
+{
+    return( *current );
+}
+
+
+WvDialMsec WvDialClock::now()
+/***************************/
+// Milliseconds on CLOCK_MONOTONIC.
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+
+    if( clock_gettime( CLOCK_MONOTONIC, &ts ) == 0 )
+	return( (WvDialMsec)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 );
+#endif
+
+    // no monotonic clock available: fall back to the wall clock.
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return( (WvDialMsec)tv.tv_sec * 1000 + tv.tv_usec / 1000 );
+}
+
+
+WvDialTimers::WvDialTimers()
+/**************************/
+{
+    count = 0;
+    for( int i = 0; i < MAX_TIMERS; i++ )
+	pos[i] = -1;
+}
+
+
+void WvDialTimers::set( int id, WvDialMsec when )
+/***********************************************/
+{
+    assert( id >= 0 && id < MAX_TIMERS );
+
+    int i = pos[id];
+    if( i < 0 ) 
+    {
+	i = count++;
+	heap[i].id = id;
+	pos[id] = i;
+	heap[i].when = when;
+	sift_up( i );
+	return;
+    }
+
+    WvDialMsec old = heap[i].when;
+    heap[i].when = when;
+    if( when < old )
+	sift_up( i );
+    else
+	sift_down( i );
+}
+
+
+void WvDialTimers::cancel( int id )
+/*********************************/
+{
+    assert( id >= 0 && id < MAX_TIMERS );
+
+    if( pos[id] >= 0 )
+	remove_at( pos[id] );
+}
+
+
+time_t WvDialTimers::msec_until( WvDialMsec now ) const
+/*****************************************************/
+{
+    if( !count )
+	return( -1 );
+    if( heap[0].when <= now )
+	return( 0 );
+    return( (time_t)( heap[0].when - now ) );
+}
+
+
+int WvDialTimers::expire( WvDialMsec now )
+/****************************************/
+{
+    if( !count || heap[0].when > now )
+	return( -1 );
+
+    int id = heap[0].id;
+    remove_at( 0 );
+    return( id );
+}
+
+
+void WvDialTimers::remove_at( int i )
+/***********************************/
+{
+    int last = --count;
+
+    pos[ heap[i].id ] = -1;
+    if( i == last )
+	return;
+
+    int moved = heap[last].id;
+    heap[i] = heap[last];
+    pos[moved] = i;
+    sift_up( i );
+    sift_down( pos[moved] );
+}
+
+
+void WvDialTimers::sift_up( int i )
+/*********************************/
+{
+    while( i > 0 && heap[ (i-1)/2 ].when > heap[i].when ) 
+    {
+	swap( i, (i-1)/2 );
+	i = (i-1)/2;
+    }
+}
+
+
+void WvDialTimers::sift_down( int i )
+/***********************************/
+{
+    for( ;; ) 
+    {
+	int smallest = i, l = 2*i + 1, r = 2*i + 2;
+
+	if( l < count && heap[l].when < heap[smallest].when )
+	    smallest = l;
+	if( r < count && heap[r].when < heap[smallest].when )
+	    smallest = r;
+	if( smallest == i )
+	    break;
+	swap( i, smallest );
+	i = smallest;
+    }
+}
+
+
+void WvDialTimers::swap( int a, int b )
+/*************************************/
+{
+    Entry tmp = heap[a];
+    heap[a] = heap[b];
+    heap[b] = tmp;
+    pos[ heap[a].id ] = a;
+    pos[ heap[b].id ] = b;
+}
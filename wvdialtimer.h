@@ -0,0 +1,118 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A tiny deadline scheduler for the WvDialer state machine.  Deadlines are
+ * kept on the monotonic clock, so they are immune to wall-clock jumps, and
+ * the dialer can sleep exactly until the next one is due.
+ *
+ * All of wvdial reads the time through wvdial_msecs(), which asks the
+ * current WvDialClock; a simulation can swap in a WvDialVirtualClock to
+ * skip the fixed delays and the dead time of a dial session.
+ *
+ */
+
+#ifndef __WVDIALTIMER_H
+#define __WVDIALTIMER_H
+
+#include <time.h>
+
+typedef long long WvDialMsec;
+
+class WvDialClock
+/***************/
+// Where wvdial gets the time, and how it waits for it to pass.  Whoever
+// waits up to 'ms' blocks for real_wait( ms ) at most; if nothing turned
+// up meanwhile, it calls idle( ms ) to say the whole wait is over.
+{
+public:
+    virtual ~WvDialClock() {}
+
+    virtual WvDialMsec	now();
+    virtual time_t	real_wait( time_t ms )
+        { return( ms ); }
+    virtual void	idle( time_t ms )
+        { }
+};
+
+
+class WvDialVirtualClock : public WvDialClock
+/*******************************************/
+// A clock that only moves when told to, or when wvdial runs out of
+// things to do: then the rest of each wait passes at once, after blocking
+// for no more than 'slice' ms of real time to give I/O a chance to arrive.
+{
+public:
+    WvDialVirtualClock( time_t slice_ms = 50 )
+	: t( 0 ), slice( slice_ms ) {}
+
+    virtual WvDialMsec	now()
+        { return( t ); }
+    virtual time_t	real_wait( time_t ms )
+        { return( ms < 0 || ms > slice ? slice : ms ); }
+    virtual void	idle( time_t ms )
+        { if( ms > 0 ) t += ms; }
+
+    void		advance( WvDialMsec ms )
+        { t += ms; }
+
+private:
+    WvDialMsec	t;
+    time_t	slice;
+};
+
+// The clock in use; NULL goes back to CLOCK_MONOTONIC.  The caller keeps
+// ownership.
+void		wvdial_set_clock( WvDialClock *clock );
+WvDialClock &	wvdial_clock();
+
+// Milliseconds on the current clock.  Only differences are meaningful.
+inline WvDialMsec wvdial_msecs()
+    { return( wvdial_clock().now() ); }
+
+
+class WvDialTimers
+/****************/
+// An indexed binary min-heap of deadlines.  Each timer is named by a small
+// integer id (0 <= id < MAX_TIMERS); setting a timer that is already
+// pending simply moves its deadline.
+{
+public:
+    enum { MAX_TIMERS = 16 };
+
+    WvDialTimers();
+
+    void	set( int id, WvDialMsec when );
+    void	cancel( int id );
+    bool	is_set( int id ) const
+        { return( pos[id] >= 0 ); }
+
+    // Deadline of the earliest timer, or -1 if none is pending.
+    WvDialMsec	next() const
+        { return( count ? heap[0].when : -1 ); }
+
+    // Milliseconds from 'now' until the earliest deadline, suitable for a
+    // select() timeout: -1 if nothing is pending, 0 if something is due.
+    time_t	msec_until( WvDialMsec now ) const;
+
+    // Remove and return the id of one timer that is due at 'now', or -1.
+    int		expire( WvDialMsec now );
+
+private:
+    struct Entry
+    {
+	WvDialMsec	when;
+	int		id;
+    };
+
+    Entry	heap[ MAX_TIMERS ];
+    int		pos[ MAX_TIMERS ];	// heap index of each id, or -1
+    int		count;
+
+    void	remove_at( int i );
+    void	sift_up( int i );
+    void	sift_down( int i );
+    void	swap( int a, int b );
+};
+
+#endif // __WVDIALTIMER_H
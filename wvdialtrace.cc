@@ -0,0 +1,207 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Timestamps for each phase of a dial session, and running percentiles
+ * of how long each phase takes.  See wvdialtrace.h.
+ *
+ */
+
+#include "wvdialtrace.h"
+
+#include <string.h>
+
+const char * WvDialTimeline::phase_names[ NUM_PHASES ] = {
+    "modem_open",
+    "init_sent",
+    "init_answered",
+    "dial_sent",
+    "connect",
+    "first_byte",
+    "prompt_response",
+    "start_ppp",
+    "pppd_spawned",
+    "ip_up",
+};
+
+
+WvDialTimeline::WvDialTimeline()
+/******************************/
+: started( false ), wall_start( 0 ), t0( 0 ), num_marks( 0 )
+{
+}
+
+void WvDialTimeline::start()
+/**************************/
+{
+    started    = true;
+    wall_start = time( NULL );
+    t0         = wvdial_msecs();
+    num_marks  = 0;
+}
+
+void WvDialTimeline::mark( Phase phase, int arg )
+/***********************************************/
+// Marks past MAX_MARKS are dropped; a session that needs that many has
+// been looping on prompts and the tail of it is not interesting.
+{
+    if( !started || num_marks >= MAX_MARKS )
+	return;
+
+    Mark & m = marks[ num_marks++ ];
+    m.phase = phase;
+    m.arg   = arg;
+    m.ms    = (long)( wvdial_msecs() - t0 );
+}
+
+bool WvDialTimeline::reached( Phase phase ) const
+/***********************************************/
+{
+    return( at( phase ) >= 0 );
+}
+
+long WvDialTimeline::at( Phase phase ) const
+/******************************************/
+{
+    for( int i = 0; i < num_marks; i++ )
+    {
+	if( marks[i].phase == phase )
+	    return( marks[i].ms );
+    }
+    return( -1 );
+}
+
+WvString WvDialTimeline::json() const
+/***********************************/
+{
+    long     ipup = at( IpUp );
+    WvString s( "{\"start\":%s,\"online\":%s,\"total_ms\":%s,\"events\":[",
+    		 (long)wall_start, ipup >= 0 ? "true" : "false",
+    		 ipup >= 0 ? ipup : elapsed() );
+
+    for( int i = 0; i < num_marks; i++ )
+    {
+	const Mark & m = marks[i];
+	if( i )
+	    s.append( "," );
+	s.append( "{\"phase\":\"%s\",\"ms\":%s", phase_names[ m.phase ], m.ms );
+	if( m.arg )
+	    s.append( ",\"n\":%s", m.arg );
+	s.append( "}" );
+    }
+    s.append( "]}" );
+    return( s );
+}
+
+
+WvDialHistogram::WvDialHistogram()
+/********************************/
+: total( 0 )
+{
+    memset( buckets, 0, sizeof( buckets ) );
+}
+
+int WvDialHistogram::bucket_of( long ms )
+/***************************************/
+// Bucket b covers (bucket_top(b-1), bucket_top(b)].  The first SUB buckets
+// are 0..3ms exactly; after that each power of two is split in SUB.
+{
+    if( ms < SUB )
+	return( ms < 0 ? 0 : (int)ms );
+
+    int  log2 = 0;
+    for( long v = ms; v >= 2*SUB; v >>= 1 )
+	log2++;
+
+    int b = SUB + log2 * SUB + (int)( ( ms >> log2 ) - SUB );
+    return( b < BUCKETS ? b : BUCKETS - 1 );
+}
+
+long WvDialHistogram::bucket_top( int b )
+/***************************************/
+{
+    if( b < SUB )
+	return( b );
+
+    int log2 = ( b - SUB ) / SUB;
+    int sub  = ( b - SUB ) % SUB;
+    return( ( (long)( SUB + sub + 1 ) << log2 ) - 1 );
+}
+
+void WvDialHistogram::add( long ms )
+/**********************************/
+{
+    buckets[ bucket_of( ms ) ]++;
+    total++;
+}
+
+long WvDialHistogram::percentile( int pct ) const
+/***********************************************/
+{
+    if( !total )
+	return( -1 );
+
+    long want = ( total * pct + 99 ) / 100;
+    if( want < 1 )
+	want = 1;
+
+    long seen = 0;
+    for( int b = 0; b < BUCKETS; b++ )
+    {
+	seen += buckets[b];
+	if( seen >= want )
+	    return( bucket_top( b ) );
+    }
+    return( bucket_top( BUCKETS - 1 ) );
+}
+
+
+WvDialPhaseStats::WvDialPhaseStats()
+/**********************************/
+: num_sessions( 0 )
+{
+}
+
+void WvDialPhaseStats::add( const WvDialTimeline & timeline )
+/***********************************************************/
+{
+    long prev = 0;
+
+    for( int i = 0; i < timeline.num_marks; i++ )
+    {
+	const WvDialTimeline::Mark & m = timeline.marks[i];
+	hist[ m.phase ].add( m.ms - prev );
+	prev = m.ms;
+    }
+
+    long ipup = timeline.at( WvDialTimeline::IpUp );
+    if( ipup >= 0 )
+	total_hist.add( ipup );
+    num_sessions++;
+}
+
+static void append_hist( WvString & s, const char * name,
+			 const WvDialHistogram & h )
+/**************************************************/
+{
+    s.append( "\"%s\":{\"count\":%s,\"p50\":%s,\"p90\":%s,\"p99\":%s}",
+    	      name, h.count(), h.percentile( 50 ), h.percentile( 90 ),
+    	      h.percentile( 99 ) );
+}
+
+WvString WvDialPhaseStats::json() const
+/*************************************/
+{
+    WvString s( "{\"sessions\":%s,\"phases\":{", num_sessions );
+
+    for( int i = 0; i < WvDialTimeline::NUM_PHASES; i++ )
+    {
+	if( i )
+	    s.append( "," );
+	append_hist( s, WvDialTimeline::phase_names[i], hist[i] );
+    }
+    s.append( "}," );
+    append_hist( s, "total", total_hist );
+    s.append( "}" );
+    return( s );
+}
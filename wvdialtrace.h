@@ -0,0 +1,131 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * Timestamps for each phase of a dial session, and running percentiles
+ * of how long each phase takes.
+ *
+ */
+
+#ifndef __WVDIALTRACE_H
+#define __WVDIALTRACE_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "wvstring.h"
+#include "wvdialtimer.h"
+
+class WvDialTimeline
+/******************/
+// One dial session, from opening the modem to the end of ip-up, as a list
+// of (phase, monotonic msec) marks.
+{
+public:
+    enum Phase {
+	ModemOpen,
+	InitSent,		// arg: which InitN
+	InitAnswered,		// arg: which InitN
+	DialSent,		// arg: which PhoneN
+	Connect,
+	FirstByte,		// first byte after carrier
+	PromptResponse,
+	StartPPP,
+	PppdSpawned,
+	IpUp,			// ip-up finished, as seen by WvDialMon
+	NUM_PHASES
+    };
+    static const char *	phase_names[ NUM_PHASES ];
+
+    WvDialTimeline();
+
+    void	start();
+    void	stop()
+        { started = false; }
+    void	mark( Phase phase, int arg = 0 );
+
+    bool	active() const
+        { return( started ); }
+    bool	reached( Phase phase ) const;
+
+    // milliseconds from the start of the session to the first mark of
+    // 'phase', or -1.
+    long	at( Phase phase ) const;
+    long	elapsed() const
+        { return( started ? (long)( wvdial_msecs() - t0 ) : -1 ); }
+
+    // The whole session as a single line of JSON (no trailing newline).
+    WvString	json() const;
+
+private:
+    enum { MAX_MARKS = 64 };
+    struct Mark
+    {
+	short		phase;
+	short		arg;
+	long		ms;		// since t0
+    };
+
+    bool	started;
+    time_t	wall_start;
+    WvDialMsec	t0;
+    Mark	marks[ MAX_MARKS ];
+    int		num_marks;
+
+    friend class WvDialPhaseStats;
+};
+
+
+class WvDialHistogram
+/*******************/
+// A log-linear histogram of millisecond durations: four buckets per power
+// of two, so percentiles come out within about 20%.
+{
+public:
+    WvDialHistogram();
+
+    void	add( long ms );
+    long	count() const
+        { return( total ); }
+
+    // The 'pct'th percentile (0..100), or -1 if there is no data.
+    long	percentile( int pct ) const;
+
+private:
+    enum { SUB = 4, BUCKETS = 26 * SUB };
+
+    long	buckets[ BUCKETS ];
+    long	total;
+
+    static int	bucket_of( long ms );
+    static long	bucket_top( int b );
+};
+
+
+class WvDialPhaseStats
+/********************/
+// Per-phase p50/p90/p99 over all sessions so far.  Each phase is measured
+// from the mark before it; "total" is from the start to ip-up.
+{
+public:
+    WvDialPhaseStats();
+
+    void	add( const WvDialTimeline & timeline );
+
+    long	sessions() const
+        { return( num_sessions ); }
+    const WvDialHistogram & phase( WvDialTimeline::Phase p ) const
+        { return( hist[p] ); }
+    const WvDialHistogram & total() const
+        { return( total_hist ); }
+
+    // All of the above as a single JSON object.
+    WvString	json() const;
+
+private:
+    WvDialHistogram	hist[ WvDialTimeline::NUM_PHASES ];
+    WvDialHistogram	total_hist;
+    long		num_sessions;
+};
+
+#endif // __WVDIALTRACE_H
@@ -8,6 +8,7 @@
  */
 #include "wvmodemscan.h"
 #include "wvmodem.h"
+#include "wvdialnorm.h"
 #include "strutils.h"
 #include <time.h>
 #include <assert.h>
@@ -447,6 +448,7 @@ size_t WvModemScan::coagulate(char *buf, size_t size, int msec)
     while (modem->select(msec, true, false))
     {
 	amt = modem->read(cptr, size-1);
+	wvdial_normalise(cptr, cptr, NULL, amt);
 	cptr[amt] = 0;
 
 	len += amt;
@@ -0,0 +1,559 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A pretend Hayes modem on a pseudo-terminal.  See wvmodemsim.h.
+ *
+ */
+
+#include "wvmodemsim.h"
+
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+
+const char * const WvModemSim::result_names[ NUM_RESULTS ] = {
+    "CONNECT", "BUSY", "NO CARRIER", "NO DIALTONE", "NO ANSWER"
+};
+
+// an LCP Configure-Request, as pppd would send it; the dialer spots PPP
+// by the "}!}" in it.
+static const char lcp_request[] = 
+    "~\xff}#\xc0!}!}!} }4}\"}&} } } } }%}&\x12\x34\x56\x78}'}\"}(}\"\x2a\x7b~";
+
+
+static WvString unescape( const char *s )
+/***************************************/
+{
+    char   buf[ 1024 ];
+    size_t len = 0;
+
+    for( ; *s && len < sizeof( buf ) - 1; s++ )
+    {
+	if( *s != '\\' || !s[1] )
+	{
+	    buf[ len++ ] = *s;
+	    continue;
+	}
+	switch( *++s )
+	{
+	case 'r':  buf[ len++ ] = '\r'; break;
+	case 'n':  buf[ len++ ] = '\n'; break;
+	case 't':  buf[ len++ ] = '\t'; break;
+	case 'x':
+	    if( isxdigit( s[1] ) && isxdigit( s[2] ) )
+	    {
+		char hex[3] = { s[1], s[2], 0 };
+		buf[ len++ ] = strtol( hex, NULL, 16 );
+		s += 2;
+		break;
+	    }
+	    // fall through
+	default:   buf[ len++ ] = *s; break;
+	}
+    }
+    buf[ len ] = '\0';
+    return( WvString( buf ).unique() );
+}
+
+
+WvModemSim::WvModemSim()
+/**********************/
+: master( -1 ), state( Closed ), state_at( 0 ), num_calls( 0 ),
+  default_result( Connect ), num_numbers( 0 ), pending_result( Connect ),
+  response_delay( 0 ), dial_delay( 0 ), byte_delay( 0 ),
+  num_steps( 0 ), step( 0 ), expect_timeout( 30000 ),
+  ppp_pid( -1 ), next_lcp( 0 ), echo( true ), cmdlen( 0 ), heardlen( 0 ),
+  outlen( 0 ), num_chunks( 0 ), out_at( 0 ), num_dropped( 0 )
+{
+    slave_name[0]  = '\0';
+    last_dialed[0] = '\0';
+    heard[0]       = '\0';
+}
+
+WvModemSim::~WvModemSim()
+/***********************/
+{
+    if( ppp_pid > 0 )
+    {
+	kill( ppp_pid, SIGTERM );
+	waitpid( ppp_pid, NULL, 0 );
+    }
+    if( master >= 0 )
+	close( master );
+}
+
+bool WvModemSim::open()
+/*********************/
+{
+    master = posix_openpt( O_RDWR | O_NOCTTY );
+    if( master < 0 )
+	return( false );
+    if( grantpt( master ) < 0 || unlockpt( master ) < 0 )
+    {
+	close( master );
+	master = -1;
+	return( false );
+    }
+    strncpy( slave_name, ptsname( master ), sizeof( slave_name ) - 1 );
+    slave_name[ sizeof( slave_name ) - 1 ] = '\0';
+    fcntl( master, F_SETFL, O_NONBLOCK );
+    fcntl( master, F_SETFD, FD_CLOEXEC );
+    return( true );
+}
+
+bool WvModemSim::parse_result( const char *name, Result &r )
+/**********************************************************/
+{
+    for( int i = 0; i < NUM_RESULTS; i++ )
+    {
+	if( !strcasecmp( name, result_names[i] ) )
+	{
+	    r = (Result)i;
+	    return( true );
+	}
+    }
+    return( false );
+}
+
+bool WvModemSim::set_result( const char *number, Result r )
+/*********************************************************/
+{
+    if( num_numbers == MAX_NUMBERS || strlen( number ) >= 32 )
+	return( false );
+    strcpy( numbers[ num_numbers ].number, number );
+    numbers[ num_numbers++ ].result = r;
+    return( true );
+}
+
+bool WvModemSim::load_script( WvStringParm filename )
+/***************************************************/
+{
+    static const struct { const char *name; Op op; } ops[] = {
+	{ "send", Send }, { "expect", Expect }, { "wait", Wait },
+	{ "timeout", Timeout }, { "ppp", PppOp }, { "hangup", Hangup },
+	{ NULL, Send }
+    };
+    FILE *f = fopen( filename, "r" );
+    char  line[ 1024 ];
+
+    if( !f )
+	return( false );
+
+    num_steps = 0;
+    while( fgets( line, sizeof( line ), f ) )
+    {
+	line[ strcspn( line, "\r\n" ) ] = '\0';
+	if( !line[0] || line[0] == '#' )
+	    continue;
+
+	char *arg = strchr( line, ' ' );
+	if( arg )
+	    *arg++ = '\0';
+	else
+	    arg = line + strlen( line );
+
+	int i;
+	for( i = 0; ops[i].name && strcmp( ops[i].name, line ); i++ )
+	    ;
+	if( !ops[i].name || num_steps == MAX_STEPS )
+	{
+	    fclose( f );
+	    return( false );
+	}
+
+	Step &s = script[ num_steps++ ];
+	s.op   = ops[i].op;
+	s.text = unescape( arg );
+	s.ms   = atol( arg );
+    }
+    fclose( f );
+    return( true );
+}
+
+int WvModemSim::getfd() const
+/***************************/
+{
+    // nothing to read until somebody opens the line, or while the PPP
+    // peer has it.
+    if( state == Closed || ( state == Ppp && ppp_pid > 0 ) )
+	return( -1 );
+    return( master );
+}
+
+long WvModemSim::msec_until( WvDialMsec now ) const
+/*************************************************/
+{
+    long ms = -1;
+
+#define SOONER( when ) \
+    do { long t = (when) - now; if( t < 0 ) t = 0; \
+	 if( ms < 0 || t < ms ) ms = t; } while( 0 )
+
+    // there's no way to be woken up by the slave being opened, or the
+    // peer exiting, so look every so often.
+    if( state == Closed || ( state == Ppp && ppp_pid > 0 ) )
+	SOONER( now + 100 );
+    if( outlen )
+	SOONER( chunks[0].at > out_at ? chunks[0].at : out_at );
+    if( state == Dialing )
+	SOONER( state_at + dial_delay );
+    if( state == Ppp && ppp_pid < 0 )
+	SOONER( next_lcp );
+    if( state == Script && step < num_steps )
+    {
+	const Step &s = script[ step ];
+	if( s.op == Wait )
+	    SOONER( state_at + s.ms );
+	else if( s.op == Expect )
+	    SOONER( state_at + expect_timeout );
+	else
+	    SOONER( now );
+    }
+    else if( state == Script )
+	SOONER( now );
+
+#undef SOONER
+    return( ms );
+}
+
+bool WvModemSim::slave_open()
+/***************************/
+// The master only reports a hangup while nobody has the slave open.
+{
+    struct pollfd p;
+    p.fd      = master;
+    p.events  = POLLIN;
+    p.revents = 0;
+    ::poll( &p, 1, 0 );
+    return( !( p.revents & POLLHUP ) );
+}
+
+void WvModemSim::set_state( State s, WvDialMsec now )
+/***************************************************/
+{
+    state    = s;
+    state_at = now;
+}
+
+void WvModemSim::poll( WvDialMsec now )
+/*************************************/
+{
+    if( master < 0 )
+	return;
+
+    if( state == Closed )
+    {
+	if( !slave_open() )
+	    return;
+	set_state( Command, now );
+	echo   = true;
+	cmdlen = outlen = 0;
+    }
+
+    if( state == Ppp && ppp_pid > 0 )
+    {
+	if( waitpid( ppp_pid, NULL, WNOHANG ) != ppp_pid )
+	    return;
+	ppp_pid = -1;
+	fcntl( master, F_SETFL, O_NONBLOCK );
+	hangup( now );
+    }
+
+    char    buf[ 512 ];
+    ssize_t len;
+    while( ( len = read( master, buf, sizeof( buf ) ) ) > 0 )
+	input( buf, len, now );
+    if( len < 0 && errno == EIO )
+    {
+	// the dialer closed the line, which hangs up whatever call.
+	set_state( Closed, now );
+	outlen = heardlen = 0;
+	heard[0] = '\0';
+	return;
+    }
+
+    if( state == Dialing && now >= state_at + dial_delay )
+    {
+	if( pending_result == Connect )
+	{
+	    queue( "\r\nCONNECT 57600\r\n", 17, 0, now );
+	    num_calls++;
+	    set_state( Script, now );
+	    step     = 0;
+	    heardlen = 0;
+	    heard[0] = '\0';
+	}
+	else
+	{
+	    WvString r( "\r\n%s\r\n", result_names[ pending_result ] );
+	    queue( r, r.len(), 0, now );
+	    set_state( Command, now );
+	}
+    }
+
+    if( state == Script )
+	run_script( now );
+
+    if( state == Ppp && ppp_pid < 0 && now >= next_lcp )
+    {
+	queue( lcp_request, sizeof( lcp_request ) - 1, 0, now );
+	next_lcp = now + 1000;
+    }
+
+    write_out( now );
+}
+
+void WvModemSim::input( const char *buf, size_t len, WvDialMsec now )
+/*******************************************************************/
+{
+    for( size_t i = 0; i < len; i++ )
+    {
+	char c = buf[i];
+	switch( state )
+	{
+	case Command:
+	    if( echo )
+		queue( &c, 1, 0, now );
+	    if( c == '\r' )
+	    {
+		command( now );
+		cmdlen = 0;
+	    }
+	    else if( c == '\b' || c == 0x7f )
+	    {
+		if( cmdlen )
+		    cmdlen--;
+	    }
+	    else if( c != '\n' && cmdlen < sizeof( cmd ) - 1 )
+		cmd[ cmdlen++ ] = c;
+	    break;
+
+	case Dialing:
+	    // any key aborts dialing.
+	    respond( "\r\nNO CARRIER\r\n", now );
+	    set_state( Command, now );
+	    cmdlen = 0;
+	    break;
+
+	case Script:
+	    if( heardlen == sizeof( heard ) - 1 )
+	    {
+		memmove( heard, heard + sizeof( heard ) / 2, 
+			 sizeof( heard ) / 2 );
+		heardlen -= sizeof( heard ) / 2;
+	    }
+	    heard[ heardlen++ ] = c;
+	    heard[ heardlen ] = '\0';
+	    break;
+
+	default:
+	    break;
+	}
+    }
+}
+
+void WvModemSim::command( WvDialMsec now )
+/****************************************/
+{
+    cmd[ cmdlen ] = '\0';
+
+    char *p = cmd;
+    while( *p == ' ' )
+	p++;
+    if( toupper( p[0] ) != 'A' || toupper( p[1] ) != 'T' )
+    {
+	// real modems ignore anything that isn't a command, and so do we;
+	// but an empty line gets nothing either.
+	return;
+    }
+
+    for( p += 2; *p; p++ )
+    {
+	switch( toupper( *p ) )
+	{
+	case 'D':
+	{
+	    // the rest of the line is the number.
+	    char  number[ 64 ];
+	    char *n = number;
+	    for( p++; *p && n < number + sizeof( number ) - 1; p++ )
+	    {
+		if( isdigit( *p ) || *p == '#' || *p == '*' || *p == '-' )
+		    *n++ = *p;
+	    }
+	    *n = '\0';
+	    strcpy( last_dialed, number );
+
+	    pending_result = default_result;
+	    for( int i = 0; i < num_numbers; i++ )
+	    {
+		if( !strcmp( numbers[i].number, number ) )
+		    pending_result = numbers[i].result;
+	    }
+	    set_state( Dialing, now );
+	    return;
+	}
+	case 'E':
+	    echo = p[1] != '0';
+	    break;
+	case 'Z':
+	    echo = true;
+	    break;
+	case 'I':
+	    respond( "\r\nWvModemSim\r\n", now );
+	    break;
+	}
+    }
+    respond( "\r\nOK\r\n", now );
+}
+
+void WvModemSim::run_script( WvDialMsec now )
+/*******************************************/
+{
+    while( state == Script && step < num_steps )
+    {
+	const Step &s = script[ step ];
+	switch( s.op )
+	{
+	case Send:
+	    queue( s.text, s.text.len(), response_delay, now );
+	    break;
+	case Wait:
+	    if( now < state_at + s.ms )
+		return;
+	    break;
+	case Timeout:
+	    expect_timeout = s.ms;
+	    break;
+	case Expect:
+	    if( !strstr( heard, s.text ) )
+	    {
+		if( now >= state_at + expect_timeout )
+		    hangup( now );
+		return;
+	    }
+	    heardlen = 0;
+	    heard[0] = '\0';
+	    break;
+	case PppOp:
+	    start_ppp( now );
+	    return;
+	case Hangup:
+	    hangup( now );
+	    return;
+	}
+	step++;
+	state_at = now;
+    }
+
+    if( state == Script )
+	start_ppp( now );
+}
+
+void WvModemSim::start_ppp( WvDialMsec now )
+/******************************************/
+{
+    set_state( Ppp, now );
+    next_lcp = now;
+    if( !ppp_command )
+	return;
+
+    // whatever is still queued goes out first, all at once.
+    fcntl( master, F_SETFL, 0 );
+    if( outlen && write( master, out, outlen ) < 0 )
+	perror( "pty" );
+    outlen = 0;
+
+    ppp_pid = fork();
+    if( ppp_pid == 0 )
+    {
+	dup2( master, 0 );
+	dup2( master, 1 );
+	execl( "/bin/sh", "sh", "-c", ppp_command.cstr(), (char *)NULL );
+	_exit( 127 );
+    }
+    if( ppp_pid < 0 )
+	fcntl( master, F_SETFL, O_NONBLOCK );
+}
+
+void WvModemSim::hangup( WvDialMsec now )
+/***************************************/
+{
+    respond( "\r\nNO CARRIER\r\n", now );
+    set_state( Command, now );
+    cmdlen = heardlen = 0;
+    heard[0] = '\0';
+}
+
+void WvModemSim::queue( const char *s, size_t len, long delay, 
+			WvDialMsec now )
+/***************************************************************/
+// Anything that doesn't fit is dropped, with a warning, since the
+// timings measured against us would be wrong otherwise without saying so.
+{
+    WvDialMsec at = now + delay;
+
+    if( !outlen )
+	num_chunks = 0;
+
+    size_t room = sizeof( out ) - outlen;
+    bool   join = num_chunks > 0 && chunks[ num_chunks - 1 ].at >= at;
+    if( !join && num_chunks == MAX_CHUNKS )
+	room = 0;
+    if( len > room )
+    {
+	fprintf( stderr, "WvModemSim: output buffer full; dropped %lu of "
+		 "%lu bytes.\n", (unsigned long)( len - room ), 
+		 (unsigned long)len );
+	num_dropped += len - room;
+	len = room;
+    }
+    if( !len )
+	return;
+
+    memcpy( out + outlen, s, len );
+    outlen += len;
+    if( !join )
+	chunks[ num_chunks++ ].at = at;
+    chunks[ num_chunks - 1 ].end = outlen;
+}
+
+void WvModemSim::write_out( WvDialMsec now )
+/******************************************/
+{
+    while( outlen && num_chunks > 0 )
+    {
+	WvDialMsec start = chunks[0].at > out_at ? chunks[0].at : out_at;
+	if( now < start )
+	    return;
+
+	// with a per-byte delay, send as many as are due by now.
+	size_t n = chunks[0].end;
+	if( byte_delay > 0 && (size_t)( ( now - start ) / byte_delay + 1 ) < n )
+	    n = ( now - start ) / byte_delay + 1;
+
+	ssize_t len = write( master, out, n );
+	if( len <= 0 )
+	    return;
+	memmove( out, out + len, outlen - len );
+	outlen -= len;
+	for( int i = 0; i < num_chunks; i++ )
+	    chunks[i].end -= len;
+	out_at = byte_delay > 0 ? start + len * byte_delay : now;
+
+	if( !chunks[0].end )
+	{
+	    num_chunks--;
+	    memmove( chunks, chunks + 1, num_chunks * sizeof( Chunk ) );
+	}
+	if( (size_t)len < n )
+	    return;	// the pty is full
+    }
+}
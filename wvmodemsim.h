@@ -0,0 +1,162 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2003 Net Integration Technologies, Inc.
+ *
+ * A pretend Hayes modem on a pseudo-terminal, for exercising the dialer
+ * without any hardware.
+ *
+ */
+
+#ifndef __WVMODEMSIM_H
+#define __WVMODEMSIM_H
+
+#include <sys/types.h>
+#include <string.h>
+
+#include "wvstring.h"
+#include "wvdialtimer.h"
+
+class WvModemSim
+/**************/
+// The dialer opens slave() like any serial port.  In command mode the
+// simulator answers AT commands with OK (or ERROR for nonsense), and ATD
+// with a result code, after the configured delays.  After CONNECT it
+// plays a script, if one was loaded:
+//
+//	send TEXT	send TEXT, with \r, \n, \t, \\ and \xHH escapes
+//	expect TEXT	wait (up to "timeout" ms) until TEXT has been received
+//	wait MS		pause
+//	timeout MS	how long later expects wait; the default is 30000
+//	ppp		hand over to the PPP peer (see set_ppp_command()), or
+//			without one, send LCP requests until the other side
+//			hangs up
+//	hangup		drop the line: NO CARRIER, and back to command mode
+//
+// Lines starting with # are ignored.  Running off the end of the script
+// is the same as "ppp".  When the dialer closes the port, the call is
+// over and the modem goes back to command mode.
+//
+// Like the rest of the dialer's helpers, it is driven from a select()
+// loop: put getfd() in the read set, sleep no longer than msec_until(),
+// and call poll() afterwards.
+{
+public:
+    enum Result { Connect, Busy, NoCarrier, NoDialtone, NoAnswer, 
+		  NUM_RESULTS };
+    static const char * const result_names[ NUM_RESULTS ];
+
+    WvModemSim();
+    ~WvModemSim();
+
+    bool	open();
+    bool	isok() const
+        { return( master >= 0 ); }
+    const char *slave() const
+        { return( slave_name ); }
+
+    // What ATD answers; a number-specific result overrides the default.
+    void	set_result( Result r )
+        { default_result = r; }
+    bool	set_result( const char *number, Result r );
+    static bool	parse_result( const char *name, Result &r );
+
+    // Milliseconds from the end of a command to its response, from ATD to
+    // the result code, and per byte sent (0 sends everything at once).
+    void	set_delays( int response_ms, int dial_ms, int byte_ms )
+        { response_delay = response_ms; dial_delay = dial_ms;
+	  byte_delay = byte_ms; }
+
+    bool	load_script( WvStringParm filename );
+
+    // Run this (with /bin/sh -c) at "ppp", with the line as its stdin and
+    // stdout, eg. "pppd notty passive".
+    void	set_ppp_command( WvStringParm cmd )
+        { ppp_command = cmd; }
+
+    // How many calls have been answered so far, and whether one is on.
+    int		calls() const
+        { return( num_calls ); }
+    bool	connected() const
+        { return( state == Script || state == Ppp ); }
+
+    // The number in the last ATD, or "" if there hasn't been one.
+    const char *dialed() const
+        { return( last_dialed ); }
+
+    // Bytes that didn't fit in the output buffer and were never sent.
+    unsigned long dropped() const
+        { return( num_dropped ); }
+
+    int		getfd() const;
+    long	msec_until( WvDialMsec now ) const;
+    void	poll( WvDialMsec now );
+
+private:
+    enum State { Closed, Command, Dialing, Script, Ppp };
+    enum Op { Send, Expect, Wait, Timeout, PppOp, Hangup };
+    enum { MAX_NUMBERS = 16, MAX_STEPS = 64, OUT_SIZE = 8192,
+	   MAX_CHUNKS = 64 };
+
+    struct Step
+    {
+	Op	 op;
+	WvString text;
+	long	 ms;
+    };
+
+    int		master;
+    char	slave_name[ 64 ];
+    State	state;
+    WvDialMsec	state_at;		// when the current state/step began
+    int		num_calls;
+    char	last_dialed[ 64 ];
+
+    Result	default_result;
+    struct { char number[ 32 ]; Result result; } numbers[ MAX_NUMBERS ];
+    int		num_numbers;
+    Result	pending_result;
+    int		response_delay, dial_delay, byte_delay;
+
+    Step	script[ MAX_STEPS ];
+    int		num_steps, step;
+    long	expect_timeout;
+
+    WvString	ppp_command;
+    pid_t	ppp_pid;
+    WvDialMsec	next_lcp;
+
+    bool	echo;
+    char	cmd[ 256 ];
+    size_t	cmdlen;
+    char	heard[ 512 ];		// script mode input, for expect
+    size_t	heardlen;
+
+    // Each queue() is a chunk of its own, which goes out no sooner than
+    // its own delay allows, and after everything queued before it.
+    struct Chunk
+    {
+	size_t		end;		// the chunk ends at out[ end ]
+	WvDialMsec	at;		// when it may start
+    };
+
+    char	out[ OUT_SIZE ];	// waiting to be written
+    size_t	outlen;
+    Chunk	chunks[ MAX_CHUNKS ];
+    int		num_chunks;
+    WvDialMsec	out_at;			// when the next byte may go
+    unsigned long num_dropped;
+
+    void	set_state( State s, WvDialMsec now );
+    void	queue( const char *s, size_t len, long delay, WvDialMsec now );
+    void	respond( const char *s, WvDialMsec now )
+        { queue( s, strlen( s ), response_delay, now ); }
+    void	write_out( WvDialMsec now );
+    void	command( WvDialMsec now );
+    void	input( const char *buf, size_t len, WvDialMsec now );
+    void	run_script( WvDialMsec now );
+    void	start_ppp( WvDialMsec now );
+    void	hangup( WvDialMsec now );
+    bool	slave_open();
+};
+
+#endif // __WVMODEMSIM_H